@@ -0,0 +1,34 @@
+"""Microbenchmark for the in-place number slots.
+
+Compares accumulation with an in-place operator ('acc += y') against
+the out-of-place form ('acc = acc + y') for every in-place slot.
+
+Usage: python benchmark/inplace.py [--number N] [--repeat R]
+"""
+import argparse
+import timeit
+
+import template
+
+
+OPERATORS = ["+", "-", "*", "/", "//", "%", "**"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--number", type=int, default=1000000)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    setup = "acc = template.example_class(1.0); y = 1.0"
+    ns = {"template": template}
+
+    print("{:<6}{:>22}{:>22}".format("op", "acc op= y (ns)", "acc = acc op y (ns)"))
+    for op in OPERATORS:
+        inplace = min(timeit.repeat("acc {}= y".format(op), setup, globals=ns, number=args.number, repeat=args.repeat))
+        binary = min(timeit.repeat("acc = acc {} y".format(op), setup, globals=ns, number=args.number, repeat=args.repeat))
+        print("{:<6}{:>22.1f}{:>22.1f}".format(op, inplace / args.number * 1e9, binary / args.number * 1e9))
+
+
+if __name__ == "__main__":
+    main()
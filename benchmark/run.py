@@ -0,0 +1,155 @@
+"""Benchmark suite for the hot paths of the template module.
+
+Measures the time per operation (ns/op) for every slot in example_classNumMethods
+and example_classSeqMethods, rich comparison, hash, repr, iteration and construction.
+Where Python's float has an equivalent operation, it is measured as well for reference.
+
+Usage:
+    python benchmark/run.py                          # print a table
+    python benchmark/run.py --output result.json     # also save the results as JSON
+    python benchmark/run.py --compare baseline.json  # report regressions against a saved run
+
+With --compare, the exit status is 1 if any benchmark got slower than the tolerance allows.
+"""
+import argparse
+import json
+import platform
+import sys
+import timeit
+
+import template
+
+
+SETUP = "x = template.example_class(1.5); y = template.example_class(2.5); f = 1.5; g = 2.5"
+
+# name, statement, equivalent statement for float (or None), extra setup
+BENCHMARKS = [
+    # number protocol
+    ("nb_add", "x + y", "f + g", ""),
+    ("nb_add (float operand)", "x + g", "f + g", ""),
+    ("nb_add (int operand)", "x + 2", "f + 2", ""),
+    ("nb_subtract", "x - y", "f - g", ""),
+    ("nb_multiply", "x * y", "f * g", ""),
+    ("nb_remainder", "x % y", "f % g", ""),
+    ("nb_divmod", "divmod(x, y)", "divmod(f, g)", ""),
+    ("nb_power", "x ** y", "f ** g", ""),
+    ("nb_negative", "-x", "-f", ""),
+    ("nb_positive", "+x", "+f", ""),
+    ("nb_absolute", "abs(x)", "abs(f)", ""),
+    ("nb_floor_divide", "x // y", "f // g", ""),
+    ("nb_true_divide", "x / y", "f / g", ""),
+    ("nb_inplace_add", "a += y", "b += g", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_inplace_subtract", "a -= y", "b -= g", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_inplace_multiply", "a *= 1.0", "b *= 1.0", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_inplace_remainder", "a %= y", "b %= g", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_inplace_power", "a **= 1.0", "b **= 1.0", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_inplace_floor_divide", "a //= 1.0", "b //= 1.0", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_inplace_true_divide", "a /= 1.0", "b /= 1.0", "a = template.example_class(1.0); b = 1.0"),
+    ("nb_bool", "bool(x)", "bool(f)", ""),
+    ("nb_int", "int(x)", "int(f)", ""),
+    ("nb_float", "float(x)", "float(f)", ""),
+    # sequence protocol
+    ("sq_length", "len(x)", None, ""),
+    ("sq_item", "x[0]", None, ""),
+    ("sq_ass_item", "x[0] = 1.5", None, ""),
+    ("sq_contains", "1.5 in x", None, ""),
+    # rich comparison
+    ("richcompare ==", "x == y", "f == g", ""),
+    ("richcompare !=", "x != y", "f != g", ""),
+    ("richcompare <", "x < y", "f < g", ""),
+    ("richcompare <=", "x <= y", "f <= g", ""),
+    ("richcompare >", "x > y", "f > g", ""),
+    ("richcompare >=", "x >= y", "f >= g", ""),
+    # everything else
+    ("tp_hash", "hash(x)", "hash(f)", ""),
+    ("repr", "repr(x)", "repr(f)", ""),
+    ("str", "str(x)", "str(f)", ""),
+    ("iteration", "for v in x: pass", None, ""),
+    ("construction", "example_class(g)", "float(g)", "example_class = template.example_class"),
+    ("construction (keyword)", "example_class(value=g)", None, "example_class = template.example_class"),
+    ("getattr value", "x.value", None, ""),
+]
+
+
+def measure(stmt, setup, repeat):
+    """Returns the best time per execution of <stmt> in nanoseconds."""
+    timer = timeit.Timer(stmt, setup, globals={"template": template})
+    number, _ = timer.autorange()
+    return min(timer.repeat(repeat=repeat, number=number)) / number * 1e9
+
+
+def run(repeat, selected):
+    results = {}
+    for name, stmt, float_stmt, extra_setup in BENCHMARKS:
+        if selected and not any(s in name for s in selected):
+            continue
+        setup = SETUP + "; " + extra_setup if extra_setup else SETUP
+        result = {"ns": measure(stmt, setup, repeat)}
+        if float_stmt is not None:
+            result["float_ns"] = measure(float_stmt, setup, repeat)
+        results[name] = result
+    return results
+
+
+def print_table(results, baseline):
+    header = "{:<28}{:>12}{:>12}{:>10}".format("benchmark", "ns/op", "float ns/op", "ratio")
+    if baseline is not None:
+        header += "{:>14}{:>10}".format("baseline ns/op", "change")
+    print(header)
+    for name, result in results.items():
+        float_ns = result.get("float_ns")
+        line = "{:<28}{:>12.1f}".format(name, result["ns"])
+        if float_ns is not None:
+            line += "{:>12.1f}{:>10.2f}".format(float_ns, result["ns"] / float_ns)
+        else:
+            line += "{:>12}{:>10}".format("-", "-")
+        if baseline is not None and name in baseline:
+            old = baseline[name]["ns"]
+            line += "{:>14.1f}{:>+9.1f}%".format(old, (result["ns"] / old - 1.0) * 100.0)
+        print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--repeat", type=int, default=5, help="number of timing runs, the best one is reported")
+    parser.add_argument("--output", help="write the results to this JSON file")
+    parser.add_argument("--compare", help="JSON file of an earlier run to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.10,
+                        help="relative slowdown allowed with --compare before a benchmark counts as a regression")
+    parser.add_argument("benchmarks", nargs="*", help="only run benchmarks whose name contains one of these strings")
+    args = parser.parse_args()
+
+    results = run(args.repeat, args.benchmarks)
+
+    baseline = None
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)["results"]
+
+    print_table(results, baseline)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump({
+                "python": sys.version,
+                "implementation": platform.python_implementation(),
+                "machine": platform.machine(),
+                "platform": platform.platform(),
+                "module": getattr(template, "__file__", None),
+                "repeat": args.repeat,
+                "results": results,
+            }, f, indent=2, sort_keys=True)
+
+    if baseline is not None:
+        regressions = [name for name, result in results.items()
+                       if name in baseline and result["ns"] > baseline[name]["ns"] * (1.0 + args.tolerance)]
+        if regressions:
+            print("\nslower than the baseline by more than {:.0%}:".format(args.tolerance))
+            for name in regressions:
+                print("  " + name)
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
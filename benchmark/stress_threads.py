@@ -0,0 +1,135 @@
+"""Multi-threaded stress test for shared instances.
+
+Every thread hammers the same objects: in-place operators on one example_class,
+.value writes racing with in-place operators on another, setitem / subscript on one example_class_array, add / discard / iteration on one
+example_class_set and example_class_map, next() on one value_reader and eval() on
+one lazy expression. The final state is checked exactly, so a lost update or a torn
+read fails the run. Meant for free-threaded builds (python3.13t), where nothing
+but the module's own locking keeps the objects consistent, but it runs anywhere.
+
+Usage: python benchmark/stress_threads.py [--threads T] [--iterations N]
+"""
+import argparse
+import sys
+import threading
+
+import template
+
+
+SLOTS = 64  # array slots owned by each thread
+KEYS = 256  # set / map keys owned by each thread
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--threads", type=int, default=8)
+    parser.add_argument("--iterations", type=int, default=20000)
+    args = parser.parse_args()
+    threads, iterations = args.threads, args.iterations
+    sys.setswitchinterval(1e-6)  # on GIL builds, switch threads as often as possible
+
+    acc = template.example_class(0.0)
+    target = template.example_class(0.0)
+    arr = template.example_class_array([0.0] * (threads * SLOTS))
+    values = template.example_class_set()
+    table = template.example_class_map()
+    text = ["{} ".format(i % 100) * 50 for i in range(iterations // 10)]
+    reader = template.value_reader(iter(text), chunk_size=100)
+    operand = template.example_class_array([float(i) for i in range(1000)])
+    expr = template.lazy(operand) * 2.0 + 1.0
+    expected_eval = template.sum(operand) * 2.0 + len(operand)
+
+    barrier = threading.Barrier(threads)
+    read_totals = [0.0] * threads
+    errors = []
+
+    def work(k):
+        try:
+            barrier.wait()
+            base = k * SLOTS
+            for i in range(iterations):
+                shared = acc
+                shared += 1.0
+                shared -= 0.5
+                shared *= 1.0
+
+                target.value = float(k * iterations + i)
+                shared = target
+                shared *= 1.0
+                y = target.value
+                if y != int(y) or not 0 <= y < threads * iterations:
+                    raise AssertionError("torn value read: {!r}".format(y))
+
+                arr[base + i % SLOTS] = float(i)
+                x = arr[(base + SLOTS + i) % len(arr)]
+                if x != x or x < 0.0:
+                    raise AssertionError("torn array read: {!r}".format(x))
+
+                key = float(k * KEYS + i % KEYS)
+                values.add(key)
+                values.discard(float(k * KEYS + (i + KEYS // 2) % KEYS))
+                table[key] = float(i)
+                table.pop(float(k * KEYS + (i + KEYS // 2) % KEYS), None)
+
+                if i % 500 == 0:
+                    try:
+                        for _ in values:
+                            pass
+                        for _ in table.items():
+                            pass
+                    except RuntimeError:
+                        pass  # changed size during iteration
+                    if template.sum(expr.eval()) != expected_eval:
+                        raise AssertionError("lazy().eval() returned a wrong result")
+
+                if i % 20 == 0:
+                    try:
+                        chunk = next(reader, None)
+                    except RuntimeError:
+                        chunk = None  # the reader is in use by another thread, its chunk goes to that thread
+                    if chunk is not None:
+                        read_totals[k] += template.sum(chunk)
+            while True:
+                try:
+                    chunk = next(reader, None)
+                except RuntimeError:
+                    continue
+                if chunk is None:
+                    break
+                read_totals[k] += template.sum(chunk)
+        except BaseException as e:
+            errors.append(e)
+
+    workers = [threading.Thread(target=work, args=(k,)) for k in range(threads)]
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+    if errors:
+        raise errors[0]
+
+    # every update is an exact operation on small integers, so the results are exact as well
+    assert acc.value == threads * iterations * 0.5, acc
+    assert target.value in {float(k * iterations + iterations - 1) for k in range(threads)}, target
+
+    def last(j, period):
+        # the last iteration i with i % period == j % period, or -1
+        return iterations - 1 - (iterations - 1 - j) % period
+
+    expected_slots = [float(max(last(j, SLOTS), 0)) for j in range(SLOTS)]
+    for k in range(threads):
+        assert list(arr[k * SLOTS:(k + 1) * SLOTS]) == expected_slots, "array slots of thread {}".format(k)
+    # a key is present if it was last added after it was last discarded
+    kept = {float(k * KEYS + j) for k in range(threads) for j in range(KEYS)
+            if last(j, KEYS) >= 0 and last(j, KEYS) > last(j - KEYS // 2, KEYS)}
+    assert set(float(v) for v in values) == kept, "set contents"
+    assert set(float(v) for v in table) == kept, "map keys"
+    assert template.sum(arr) == threads * sum(expected_slots), "array sum"
+    assert sum(read_totals) == sum(sum(float(v) for v in block.split()) for block in text), "value_reader total"
+
+    gil = getattr(sys, "_is_gil_enabled", lambda: True)()
+    print("ok: {} threads x {} iterations, GIL {}".format(threads, iterations, "enabled" if gil else "disabled"))
+
+
+if __name__ == "__main__":
+    main()
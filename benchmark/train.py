@@ -0,0 +1,60 @@
+"""Training workload for profile-guided builds (TEMPLATE_PGO=1 python setup.py build_ext).
+
+Runs every statement of the benchmark suite a fixed number of times, so the number, sequence
+and comparison slots are profiled in the proportions they are benchmarked in, followed by
+the bulk functions on inputs large enough to reach their parallel paths.
+The module under training must be importable, setup.py puts it on PYTHONPATH.
+
+Usage: python benchmark/train.py [--number N]
+"""
+import argparse
+import array
+import random
+import timeit
+
+import template
+
+from run import BENCHMARKS, SETUP
+
+
+BULK = [
+    "template.add_many(a, b)",
+    "template.mul_many(a, 2.0)",
+    "template.truediv_many(a, b)",
+    "template.sum(a)",
+    "template.min(a)",
+    "template.dot(a, b)",
+    "template.sort(a)",
+    "template.argsort(b, reverse=True)",
+    "template.topk(a, 10)",
+    "template.searchsorted(s, b[:1000])",
+    "template.from_iterable(l)",
+    "template.to_floats(l)",
+    "template.dumps(a)",
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--number", type=int, default=20000, help="executions of every benchmark statement")
+    args = parser.parse_args()
+
+    for name, stmt, float_stmt, extra_setup in BENCHMARKS:
+        setup = SETUP + "; " + extra_setup if extra_setup else SETUP
+        timeit.Timer(stmt, setup, globals={"template": template}).timeit(args.number)
+
+    rng = random.Random(0)
+    values = [rng.uniform(-1e6, 1e6) for _ in range(300000)]
+    ns = {
+        "template": template,
+        "a": array.array("d", values),
+        "b": array.array("d", reversed(values)),
+        "s": template.sort(array.array("d", values)),
+        "l": [template.example_class(v) for v in values[:10000]],
+    }
+    for stmt in BULK:
+        timeit.Timer(stmt, globals=ns).timeit(max(1, args.number // 2000))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,43 @@
+"""Microbenchmark for the operand conversion in unpack_example_class.
+
+Measures the time per binary operation for each kind of right-hand operand
+(example_class, float, int, bool, and a duck-typed object implementing __float__).
+
+Usage: python benchmark/unpack.py [--number N] [--repeat R]
+"""
+import argparse
+import timeit
+
+import template
+
+
+class Duck(object):
+    def __float__(self):
+        return 2.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--number", type=int, default=1000000)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    operands = [
+        ("example_class", template.example_class(2.0)),
+        ("float", 2.0),
+        ("int", 2),
+        ("bool", True),
+        ("__float__", Duck()),
+    ]
+    x = template.example_class(1.5)
+
+    print("{:<16}{:>12}{:>12}".format("operand", "x + y (ns)", "x == y (ns)"))
+    for name, y in operands:
+        ns = {"x": x, "y": y}
+        add = min(timeit.repeat("x + y", globals=ns, number=args.number, repeat=args.repeat))
+        eq = min(timeit.repeat("x == y", globals=ns, number=args.number, repeat=args.repeat))
+        print("{:<16}{:>12.1f}{:>12.1f}".format(name, add / args.number * 1e9, eq / args.number * 1e9))
+
+
+if __name__ == "__main__":
+    main()
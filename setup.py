@@ -6,15 +6,97 @@ https://github.com/pypa/sampleproject
 
 # Always prefer setuptools over distutils
 from setuptools import setup, find_packages, Extension
+from setuptools.command.build_ext import build_ext
+from distutils import log
 # To use a consistent encoding
 from codecs import open
 from os import path
+import glob
+import os
+import shutil
+import subprocess
+import sys
 
 module1 = Extension('template',
-                    sources = ['template.c'])
+                    sources = ['template.cpp'],
+                    language = 'c++')
 
 here = path.abspath(path.dirname(__file__))
 
+# Build options, set as environment variables:
+#   TEMPLATE_LTO=0      build without link time optimization
+#   TEMPLATE_PGO=1      profile-guided build (GCC or Clang): builds an instrumented module,
+#                       runs benchmark/train.py with it and rebuilds using the recorded profile
+#   TEMPLATE_CFLAGS     extra compiler flags, e.g. "-DTEMPLATE_STATS=1"
+# The arithmetic hot paths are compiled for several instruction sets (target_clones)
+# where the toolchain supports it, see BATCH_CLONES in template.cpp. PGO builds go without:
+# GCC's instrumented ifunc resolvers crash on load and the clones don't match the profile.
+def env_flag(name, default):
+    return os.environ.get(name, default).strip().lower() not in ("", "0", "no", "false", "off")
+
+class optimized_build_ext(build_ext):
+    """build_ext with optimization flags for the compiler in use and an optional PGO cycle."""
+
+    def build_extensions(self):
+        self.msvc = self.compiler.compiler_type == "msvc"
+        self.clang = False
+        if not self.msvc:
+            try:
+                version = subprocess.check_output(self.compiler.compiler_so[:1] + ["--version"], stderr=subprocess.STDOUT)
+                self.clang = b"clang" in version
+            except (OSError, subprocess.CalledProcessError):
+                pass
+
+        if not env_flag("TEMPLATE_PGO", "0"):
+            self.build_all([])
+        elif self.msvc:
+            log.warn("TEMPLATE_PGO is only supported with GCC and Clang, building without a profile")
+            self.build_all([])
+        else:
+            self.build_with_profile()
+
+    def build_all(self, flags):
+        lto = env_flag("TEMPLATE_LTO", "1")
+        if self.msvc:
+            compile_args = ["/O2", "/std:c++17"] + (["/GL"] if lto else [])
+            link_args = ["/LTCG"] if lto else []
+        else:
+            compile_args = ["-O3", "-std=c++17"] + (["-flto"] if lto else [])
+            link_args = ["-O3"] + (["-flto"] if lto else [])
+        compile_args += os.environ.get("TEMPLATE_CFLAGS", "").split()
+        for ext in self.extensions:
+            ext.extra_compile_args = compile_args + flags
+            ext.extra_link_args = link_args + flags
+        build_ext.build_extensions(self)
+
+    def build_with_profile(self):
+        profile_dir = path.abspath(path.join(self.build_temp, "pgo"))
+        if path.isdir(profile_dir):
+            shutil.rmtree(profile_dir)
+        os.makedirs(profile_dir)
+
+        # the instrumented build
+        self.force = True
+        instrument = ["-DTEMPLATE_NO_CLONES", "-fprofile-generate=" + profile_dir]
+        if not self.clang:
+            instrument.append("-fprofile-update=prefer-atomic") # the thread pool updates counters concurrently
+        self.build_all(instrument)
+
+        log.info("running benchmark/train.py for the profile")
+        env = dict(os.environ)
+        module_dir = path.dirname(path.abspath(self.get_ext_fullpath(self.extensions[0].name)))
+        env["PYTHONPATH"] = module_dir + os.pathsep + env.get("PYTHONPATH", "")
+        subprocess.check_call([sys.executable, path.join(here, "benchmark", "train.py")], env=env, cwd=module_dir)
+
+        if self.clang:
+            profile = path.join(profile_dir, "default.profdata")
+            subprocess.check_call([os.environ.get("LLVM_PROFDATA", "llvm-profdata"), "merge", "-output=" + profile]
+                                  + glob.glob(path.join(profile_dir, "*.profraw")))
+            optimize = ["-DTEMPLATE_NO_CLONES", "-fprofile-use=" + profile]
+        else:
+            optimize = ["-DTEMPLATE_NO_CLONES", "-fprofile-use=" + profile_dir, "-fprofile-correction"]
+        self.build_all(optimize)
+
 # Get the long description from the README file
 with open(path.join(here, 'README.rst'), encoding='utf-8') as f:
     long_description_list = f.readlines()
@@ -94,6 +176,8 @@ setup(
 
     ext_modules = [module1],
 
+    cmdclass = {'build_ext': optimized_build_ext},
+
     # List run-time dependencies here.  These will be installed by pip when
     # your project is installed. For an analysis of "install_requires" vs pip's
     # requirements files see:
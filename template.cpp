@@ -1,20 +1,74 @@
 #include <Python.h>
 #include "structmember.h"
 #include <stdbool.h>
+#include <float.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) || defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #define PY3K (PY_VERSION_HEX >= 0x03000000)
 
-double pi; // later we import this value from the math module
+// the types are created per module object from Python 3.9 on, see "module state"
+#define TEMPLATE_HEAP_TYPES (PY_VERSION_HEX >= 0x03090000)
 
 #if PY3K
 #define Py_TPFLAGS_CHECKTYPES 0
+#else
+typedef long Py_hash_t;
 #endif
 
+#define PyType_AS_CSTRING(op) op->ob_type->tp_name
+
+#define Py_RAISE_TYPEERROR_O(str, obj) PyErr_Format(PyExc_TypeError, "%s'%s'", str, PyType_AS_CSTRING(obj))
+#define Py_RAISE_TYPEERROR_2O(str, obj1, obj2) PyErr_Format(PyExc_TypeError, "%s'%s' and '%s'", str, PyType_AS_CSTRING(obj1), PyType_AS_CSTRING(obj2))
+
 #if !PY3K
 #define Py_RETURN_NOTIMPLEMENTED return Py_INCREF(Py_NotImplemented), Py_NotImplemented
 #define PyLong_AS_LONG(op) PyLong_AsLong(op)
 #define PyExtNumber_Check(op) (PyLong_Check(op) || PyInt_Check(op) || PyFloat_Check(op) || PyBool_Check(op))
 #endif
+
+// example_class values are read directly wherever a number is expected, without a temporary float or int
+typedef struct _example_class example_class;
+static PyObject* example_class_float(example_class* self);
+static double example_class_value(PyObject* op);
+static bool variant_to_double(PyObject* op, double* out); // example_class_f32 and example_class_i64
+static PyObject* variant_compare_i64(double value, PyObject* op, int comp_type); // NULL without an exception if op isn't an example_class_i64
+#define PyExtNumber_IsExampleClass(op) (Py_TYPE(op)->tp_as_number != NULL && Py_TYPE(op)->tp_as_number->nb_float == (unaryfunc)example_class_float)
+
 bool PyExtNumber_Check(PyObject* arg) {
 #if PY3K
 	if (PyFloat_Check(arg) || PyLong_Check(arg) || PyBool_Check(arg)) {
@@ -23,6 +77,9 @@ bool PyExtNumber_Check(PyObject* arg) {
 #endif
 		return true;
 	}
+	if (PyExtNumber_IsExampleClass(arg)) {
+		return true;
+	}
 	if (arg->ob_type->tp_as_number != NULL && arg->ob_type->tp_as_number->nb_float != NULL) {
 		PyObject* temp = PyNumber_Float(arg);
 		if (temp != NULL) {
@@ -34,25 +91,59 @@ bool PyExtNumber_Check(PyObject* arg) {
 	return false;
 }
 
-double PyExtNumber_AsDouble(PyObject* arg) {
-	if (PyFloat_Check(arg)) {
-		return PyFloat_AS_DOUBLE(arg);
+int PyExtNumber_ToDouble(PyObject* arg, double* out) {
+	/* Checks and converts <arg> in a single pass.
+	 * Returns 1 on success, 0 if <arg> is not a number (no error is set)
+	 * or -1 if the conversion raised an error.
+	 */
+	if (PyFloat_CheckExact(arg)) {
+		*out = PyFloat_AS_DOUBLE(arg);
+		return 1;
+	}
+	if (PyLong_CheckExact(arg)) {
+		*out = PyLong_AsDouble(arg);
+		return (*out == -1.0 && PyErr_Occurred()) ? -1 : 1;
 	}
 #if !PY3K
 	if (PyInt_Check(arg)) {
-		return (double)PyInt_AS_LONG(arg);
+		*out = (double)PyInt_AS_LONG(arg);
+		return 1;
 	}
 #endif
-	if (PyLong_Check(arg)) {
-		return (double)PyLong_AsDouble(arg);
+	if (PyFloat_Check(arg)) {
+		*out = PyFloat_AS_DOUBLE(arg);
+		return 1;
 	}
-	if (PyBool_Check(arg)) {
-		return (arg == Py_True) ? 1.0 : 0.0;
+	if (PyLong_Check(arg)) { // includes bool
+		*out = PyLong_AsDouble(arg);
+		return (*out == -1.0 && PyErr_Occurred()) ? -1 : 1;
 	}
-	PyObject* arg_as_float = PyNumber_Float(arg);
-	double out = PyFloat_AS_DOUBLE(arg_as_float);
-	Py_DECREF(arg_as_float);
-	return out;
+	if (PyExtNumber_IsExampleClass(arg)) {
+		*out = example_class_value(arg);
+		return 1;
+	}
+	if (variant_to_double(arg, out)) {
+		return 1;
+	}
+	if (arg->ob_type->tp_as_number != NULL && arg->ob_type->tp_as_number->nb_float != NULL) {
+		PyObject* arg_as_float = PyNumber_Float(arg);
+		if (arg_as_float == NULL) {
+			return -1;
+		}
+		*out = PyFloat_AS_DOUBLE(arg_as_float);
+		Py_DECREF(arg_as_float);
+		return 1;
+	}
+	return 0;
+}
+
+double PyExtNumber_AsDouble(PyObject* arg) {
+	double out;
+	int result = PyExtNumber_ToDouble(arg, &out);
+	if (result == 0) {
+		Py_RAISE_TYPEERROR_O("must be a real number, not ", arg);
+	}
+	return (result == 1) ? out : -1.0;
 }
 
 long PyExtNumber_AsLong(PyObject* arg) {
@@ -70,7 +161,13 @@ long PyExtNumber_AsLong(PyObject* arg) {
 	if (PyBool_Check(arg)) {
 		return (arg == Py_True) ? 1 : 0;
 	}
+	if (PyExtNumber_IsExampleClass(arg)) {
+		return (long)example_class_value(arg);
+	}
 	PyObject* arg_as_long = PyNumber_Long(arg);
+	if (arg_as_long == NULL) {
+		return -1;
+	}
 	long out = PyLong_AS_LONG(arg_as_long);
 	Py_DECREF(arg_as_long);
 	return out;
@@ -91,7 +188,13 @@ float PyExtNumber_AsFloat(PyObject* arg) {
 	if (PyBool_Check(arg)) {
 		return (arg == Py_True) ? 1.f : 0.f;
 	}
+	if (PyExtNumber_IsExampleClass(arg)) {
+		return (float)example_class_value(arg);
+	}
 	PyObject* arg_as_float = PyNumber_Float(arg);
+	if (arg_as_float == NULL) {
+		return -1.f;
+	}
 	float out = (float)PyFloat_AS_DOUBLE(arg_as_float);
 	Py_DECREF(arg_as_float);
 	return out;
@@ -100,20 +203,99 @@ float PyExtNumber_AsFloat(PyObject* arg) {
 
 #define Py_IS_NOTIMPLEMENTED(op) (op == NULL || (PyObject*)op == Py_NotImplemented) // find out if op is NULL or NotImplemented
 
-#define PyType_AS_CSTRING(op) op->ob_type->tp_name
+// to be used after unpack_example_class(state, ) failed: propagates a conversion error, otherwise returns NotImplemented
+#define Py_RETURN_NOTIMPLEMENTED_OR_ERROR if (PyErr_Occurred()) return NULL; TEMPLATE_COUNT(STAT_NOT_IMPLEMENTED); Py_RETURN_NOTIMPLEMENTED
+
+// argument parsing
+/* Functions taking several arguments use the fastcall convention where it is available (Python 3.7+),
+ * so no argument tuples or keyword dicts have to be built for a call. On older versions they fall back to
+ * METH_VARARGS, where the arguments are read straight out of the tuple.
+ * Use FASTCALL_PARAMS / FASTCALL_KEYWORDS_PARAMS as the parameter list and
+ * FASTCALL_PARSE / FASTCALL_KEYWORDS_PARSE to unpack the arguments.
+ */
+#if PY_VERSION_HEX >= 0x03070000
+#define METH_FASTCALL_COMPAT METH_FASTCALL
+#define FASTCALL_PARAMS PyObject* const* args, Py_ssize_t nargs
+#define FASTCALL_KEYWORDS_PARAMS PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+#define FASTCALL_PARSE(fname, kwlist, required, out) parse_arguments(fname, kwlist, required, args, nargs, NULL, NULL, out)
+#define FASTCALL_KEYWORDS_PARSE(fname, kwlist, required, out) parse_arguments(fname, kwlist, required, args, nargs, kwnames, NULL, out)
+#else
+#define METH_FASTCALL_COMPAT METH_VARARGS
+#define FASTCALL_PARAMS PyObject* args
+#define FASTCALL_KEYWORDS_PARAMS PyObject* args, PyObject* kwargs
+#define FASTCALL_PARSE(fname, kwlist, required, out) parse_arguments(fname, kwlist, required, &PyTuple_GET_ITEM(args, 0), PyTuple_GET_SIZE(args), NULL, NULL, out)
+#define FASTCALL_KEYWORDS_PARSE(fname, kwlist, required, out) parse_arguments(fname, kwlist, required, &PyTuple_GET_ITEM(args, 0), PyTuple_GET_SIZE(args), NULL, kwargs, out)
+#endif
 
-#define Py_RAISE_TYPEERROR_O(str, obj) PyErr_Format(PyExc_TypeError, "%s'%s'", str, PyType_AS_CSTRING(obj))
-#define Py_RAISE_TYPEERROR_2O(str, obj1, obj2) PyErr_Format(PyExc_TypeError, "%s'%s' and '%s'", str, PyType_AS_CSTRING(obj1), PyType_AS_CSTRING(obj2))
+static bool keyword_equals(PyObject* key, const char* name) {
+#if PY3K
+	return PyUnicode_Check(key) && PyUnicode_CompareWithASCIIString(key, name) == 0;
+#else
+	return PyString_Check(key) && strcmp(PyString_AS_STRING(key), name) == 0;
+#endif
+}
+
+static bool parse_arguments(const char* fname, const char* const* kwlist, Py_ssize_t required,
+	PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames, PyObject* kwargs, PyObject** out) {
+	/* Stores the arguments for the NULL terminated parameter names <kwlist> into <out> (borrowed references),
+	 * leaving omitted optional arguments NULL. The keyword arguments are either given
+	 * as a vectorcall <kwnames> tuple (with the values following the positional ones in <args>), or as a dict.
+	 */
+	Py_ssize_t count = 0;
+	while (kwlist[count] != NULL) {
+		out[count++] = NULL;
+	}
+	if (nargs > count) {
+		PyErr_Format(PyExc_TypeError, "%s() takes at most %zd argument(s) (%zd given)", fname, count, nargs);
+		return false;
+	}
+	for (Py_ssize_t i = 0; i < nargs; i++) {
+		out[i] = args[i];
+	}
 
-static char * attr_name_to_cstr(PyObject * name) {
+	Py_ssize_t kw_index = 0, kw_pos = 0;
+	PyObject* key;
+	PyObject* value;
+	for (;;) {
+		if (kwnames != NULL) {
+			if (kw_index >= PyTuple_GET_SIZE(kwnames)) {
+				break;
+			}
+			key = PyTuple_GET_ITEM(kwnames, kw_index);
+			value = args[nargs + kw_index++];
+		}
+		else if (kwargs == NULL || !PyDict_Next(kwargs, &kw_pos, &key, &value)) {
+			break;
+		}
+		Py_ssize_t i = 0;
+		while (i < count && !keyword_equals(key, kwlist[i])) {
+			i++;
+		}
+		if (i == count) {
 #if PY3K
-	return PyBytes_AsString(PyUnicode_AsASCIIString(name));
+			PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%S'", fname, key);
 #else
-	return PyString_AsString(name);
+			PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument", fname);
 #endif
+			return false;
+		}
+		if (out[i] != NULL) {
+			PyErr_Format(PyExc_TypeError, "%s() got multiple values for argument '%s'", fname, kwlist[i]);
+			return false;
+		}
+		out[i] = value;
+	}
+
+	for (Py_ssize_t i = 0; i < required; i++) {
+		if (out[i] == NULL) {
+			PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s' (pos %zd)", fname, kwlist[i], i + 1);
+			return false;
+		}
+	}
+	return true;
 }
 
-typedef struct {
+typedef struct _example_class {
 	PyObject_HEAD
 		double value;
 } example_class;
@@ -128,6 +310,361 @@ typedef struct {
 	double value;
 } internal_example_class;
 
+typedef struct {
+	PyObject_HEAD
+		Py_ssize_t length;
+	Py_ssize_t allocated;
+	Py_ssize_t exports; // number of exported buffers, the storage must not be reallocated while > 0
+	double *data; // contiguous storage, allocated with PyMem_Malloc
+} example_class_array;
+
+typedef struct {
+	uint64_t *keys; // canonical bit patterns of the keys, see double_table_key()
+	PyObject **values; // NULL for sets
+	Py_ssize_t size; // number of slots, 0 or a power of 2
+	Py_ssize_t used;
+	size_t version; // changes whenever a key is added or removed
+	bool has_values;
+} double_table;
+
+typedef struct {
+	PyObject_HEAD
+		double_table table;
+} example_class_set;
+
+typedef struct {
+	PyObject_HEAD
+		double_table table;
+} example_class_map;
+
+enum mapped_mode { MAPPED_READ, MAPPED_COPY, MAPPED_WRITE };
+
+typedef struct {
+	PyObject_HEAD
+		Py_ssize_t length;
+	Py_ssize_t exports; // number of exported buffers, the file must not be unmapped while > 0
+	double *data; // the values inside the mapping
+	char *base; // start of the mapping, NULL if closed or the file is empty
+	size_t map_length;
+	mapped_mode mode;
+	bool closed;
+	PyObject *path;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+} mapped_values;
+
+enum reader_kind { READER_FD, READER_READINTO, READER_READ, READER_ITERATOR };
+
+typedef struct {
+	PyObject_HEAD
+		PyObject *source; // file object or iterator, NULL for file descriptors
+	int fd;
+	reader_kind kind;
+	Py_ssize_t chunk_size; // maximum number of values per chunk
+	bool binary;
+	bool reuse;
+	bool eof; // the source is exhausted, only buffered input remains
+	bool busy; // set while a chunk is being read, the GIL may be released in the meantime
+	char *raw; // input that hasn't been parsed yet is raw[raw_start:raw_end], followed by a null byte
+	Py_ssize_t raw_start;
+	Py_ssize_t raw_end;
+	Py_ssize_t raw_size;
+	Py_ssize_t offset; // position of raw[0] in the input, for error messages
+	example_class_array *chunk; // the most recently returned chunk
+} value_reader;
+
+enum table_iter_kind { TABLE_ITER_KEYS, TABLE_ITER_VALUES, TABLE_ITER_ITEMS };
+
+typedef struct {
+	PyObject_HEAD
+		PyObject *container;
+	double_table *table;
+	Py_ssize_t pos;
+	size_t version;
+	table_iter_kind kind;
+} example_class_tableIter;
+
+enum expr_kind { EXPR_CONSTANT, EXPR_VALUES, EXPR_ARGUMENT, EXPR_BINARY, EXPR_NEGATIVE, EXPR_POSITIVE, EXPR_ABSOLUTE };
+
+struct expr_program;
+
+typedef struct {
+	PyObject_HEAD
+		expr_kind kind;
+	int op; // the batch_op of EXPR_BINARY nodes
+	int depth; // 1 for leaves
+	double value; // EXPR_CONSTANT
+	PyObject *left; // the values of EXPR_VALUES, the operand of unary nodes or the left operand of EXPR_BINARY
+	PyObject *right; // the right operand of EXPR_BINARY
+	expr_program *program; // compiled on the first evaluation, the tree never changes
+} example_class_expr;
+
+// module state
+/* Everything a module object owns: its types, cached objects and the example_class freelist.
+ * With TEMPLATE_HEAP_TYPES, the module uses multi-phase initialization (PEP 489) and creates its types
+ * from PyType_Specs, so every (sub)interpreter that imports it gets an independent copy (PEP 630).
+ * Code finds the state through the type of one of its objects, or through the module passed to module functions.
+ * Older versions use static types and one process-wide state.
+ */
+typedef struct {
+	example_class* head; // the free objects are linked through their ob_type field
+	Py_ssize_t size;
+	Py_ssize_t capacity;
+	unsigned long long hits;
+	unsigned long long misses;
+} example_class_freelist_state;
+
+typedef struct {
+	PyTypeObject* example_class_type;
+	PyTypeObject* example_classIter_type;
+	PyTypeObject* example_class_array_type;
+	PyTypeObject* example_class_set_type;
+	PyTypeObject* example_class_map_type;
+	PyTypeObject* example_class_tableIter_type;
+	PyTypeObject* mapped_values_type;
+	PyTypeObject* value_reader_type;
+	PyTypeObject* example_class_expr_type;
+	PyTypeObject* example_class_f32_type;
+	PyTypeObject* example_class_i64_type;
+	PyObject* pi; // math.pi, returned by example_class.secret
+	example_class_freelist_state freelist;
+} template_state;
+
+static template_state* template_state_of_type(PyTypeObject* type);
+static template_state* template_state_of_module(PyObject* module);
+
+static inline template_state* template_state_of(PyObject* op) {
+	// the state of the module that created the type of <op>, which must be one of the module's types (or a subclass)
+	return template_state_of_type(Py_TYPE(op));
+}
+
+static inline template_state* template_state_of_operands(PyObject* obj1, PyObject* obj2) {
+	// for number slots, where either operand may be the one of the module's types
+	template_state* state = template_state_of_type(Py_TYPE(obj1));
+	return (state != NULL) ? state : template_state_of_type(Py_TYPE(obj2));
+}
+
+#if PY_VERSION_HEX >= 0x030A0000
+#define Py_TPFLAGS_IMMUTABLETYPE_COMPAT Py_TPFLAGS_IMMUTABLETYPE
+#define Py_TPFLAGS_DISALLOW_INSTANTIATION_COMPAT Py_TPFLAGS_DISALLOW_INSTANTIATION
+#else
+#define Py_TPFLAGS_IMMUTABLETYPE_COMPAT 0
+#define Py_TPFLAGS_DISALLOW_INSTANTIATION_COMPAT 0 // tp_new is cleared once the type has been created instead
+#endif
+
+#if TEMPLATE_HEAP_TYPES
+// instances of heap types own a reference to their type: tp_dealloc releases it, tp_traverse visits it
+#define Py_DECREF_HEAPTYPE(type) Py_DECREF(type)
+#define Py_VISIT_HEAPTYPE(op) Py_VISIT(Py_TYPE(op))
+#else
+#define Py_DECREF_HEAPTYPE(type)
+#define Py_VISIT_HEAPTYPE(op)
+#endif
+
+// thread safety
+/* On free-threaded builds (PEP 703, Py_GIL_DISABLED) the module doesn't need the GIL.
+ * example_class values are read and written with relaxed atomics, read-modify-write operations such as
+ * 'a += b' hold the object's critical section, and the methods and slots of the container types run inside
+ * the critical section of the container (TEMPLATE_LOCKED). With the GIL, all of this compiles to plain code.
+ * Writes through an exported buffer (memoryview(a)[0] = ...) aren't synchronized, as with any other buffer.
+ */
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
+
+#ifdef Py_GIL_DISABLED
+static inline double example_class_load(const example_class* self) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	__int64 bits = __iso_volatile_load64((const volatile __int64*)&self->value);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+#else
+	double value;
+	__atomic_load(&self->value, &value, __ATOMIC_RELAXED);
+	return value;
+#endif
+}
+
+static inline void example_class_store(example_class* self, double value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	__int64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	__iso_volatile_store64((volatile __int64*)&self->value, bits);
+#else
+	__atomic_store(&self->value, &value, __ATOMIC_RELAXED);
+#endif
+}
+
+struct template_critical_section {
+	// holds the critical section of <op> for the lifetime of the object
+	PyCriticalSection section;
+	template_critical_section(PyObject* op) { PyCriticalSection_Begin(&section, op); }
+	~template_critical_section() { PyCriticalSection_End(&section); }
+};
+
+template<auto Function>
+struct template_locked;
+
+template<typename Self, typename Result, typename... Args, Result(*Function)(Self*, Args...)>
+struct template_locked<Function> {
+	// calls Function with the critical section of its first argument held
+	static Result call(Self* self, Args... args) {
+		template_critical_section section((PyObject*)self);
+		return Function(self, args...);
+	}
+};
+
+#define TEMPLATE_LOCKED(function) (template_locked<function>::call)
+#else
+static inline double example_class_load(const example_class* self) {
+	return self->value;
+}
+
+static inline void example_class_store(example_class* self, double value) {
+	self->value = value;
+}
+
+#define TEMPLATE_LOCKED(function) (function)
+#endif
+
+static double example_class_value(PyObject* op) {
+	return example_class_load((example_class*)op);
+}
+
+// statistics
+/* Compile with TEMPLATE_STATS=1 to count how often the hot paths are taken, see template.stats().
+ * Every thread increments its own block of counters, so counting needs neither locks nor atomic read-modify-write;
+ * the blocks are summed when the statistics are read. Otherwise TEMPLATE_COUNT() expands to nothing.
+ */
+#ifndef TEMPLATE_STATS
+#define TEMPLATE_STATS 0
+#endif
+
+enum stat_counter {
+	STAT_NB_ADD,
+	STAT_NB_SUBTRACT,
+	STAT_NB_MULTIPLY,
+	STAT_NB_TRUE_DIVIDE,
+	STAT_NB_FLOOR_DIVIDE,
+	STAT_NB_REMAINDER,
+	STAT_NB_DIVMOD,
+	STAT_NB_POWER,
+	STAT_NB_NEGATIVE,
+	STAT_NB_POSITIVE,
+	STAT_NB_ABSOLUTE,
+	STAT_NB_INPLACE_ADD,
+	STAT_NB_INPLACE_SUBTRACT,
+	STAT_NB_INPLACE_MULTIPLY,
+	STAT_NB_INPLACE_TRUE_DIVIDE,
+	STAT_NB_INPLACE_FLOOR_DIVIDE,
+	STAT_NB_INPLACE_REMAINDER,
+	STAT_NB_INPLACE_POWER,
+	STAT_RICHCOMPARE,
+	STAT_NOT_IMPLEMENTED,
+	STAT_UNPACK_EXACT,
+	STAT_UNPACK_SUBCLASS,
+	STAT_UNPACK_FLOAT,
+	STAT_UNPACK_INT,
+	STAT_UNPACK_DUCK,
+	STAT_UNPACK_FAILED,
+	STAT_ALLOC,
+	STAT_FREELIST_HIT,
+	STAT_ITER_CREATED,
+	STAT_TABLE_ITER_CREATED,
+	STAT_COUNT
+};
+
+#if TEMPLATE_STATS
+static const char* const stat_counter_names[STAT_COUNT] = {
+	"nb_add",
+	"nb_subtract",
+	"nb_multiply",
+	"nb_true_divide",
+	"nb_floor_divide",
+	"nb_remainder",
+	"nb_divmod",
+	"nb_power",
+	"nb_negative",
+	"nb_positive",
+	"nb_absolute",
+	"nb_inplace_add",
+	"nb_inplace_subtract",
+	"nb_inplace_multiply",
+	"nb_inplace_true_divide",
+	"nb_inplace_floor_divide",
+	"nb_inplace_remainder",
+	"nb_inplace_power",
+	"richcompare",
+	"not_implemented",
+	"unpack_exact",
+	"unpack_subclass",
+	"unpack_float",
+	"unpack_int",
+	"unpack_duck",
+	"unpack_failed",
+	"alloc",
+	"freelist_hit",
+	"iter_created",
+	"table_iter_created",
+};
+
+struct stat_block {
+	std::atomic<unsigned long long> counts[STAT_COUNT]; // only written by the owning thread
+	stat_block();
+	~stat_block();
+};
+
+static std::mutex stat_mutex; // guards the variables below
+static std::vector<stat_block*> stat_blocks; // the blocks of the running threads
+static unsigned long long stat_retired[STAT_COUNT]; // counts of the threads that have exited
+static unsigned long long stat_baseline[STAT_COUNT]; // subtracted from the totals, set by template.reset_stats()
+
+stat_block::stat_block() {
+	for (int i = 0; i < STAT_COUNT; i++) {
+		counts[i].store(0, std::memory_order_relaxed);
+	}
+	std::lock_guard<std::mutex> lock(stat_mutex);
+	stat_blocks.push_back(this);
+}
+
+stat_block::~stat_block() {
+	std::lock_guard<std::mutex> lock(stat_mutex);
+	for (int i = 0; i < STAT_COUNT; i++) {
+		stat_retired[i] += counts[i].load(std::memory_order_relaxed);
+	}
+	stat_blocks.erase(std::find(stat_blocks.begin(), stat_blocks.end(), this));
+}
+
+static thread_local stat_block stat_local;
+
+static inline void stat_count(stat_counter counter) {
+	std::atomic<unsigned long long>& count = stat_local.counts[counter];
+	count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static void stat_totals(unsigned long long* out) {
+	// stat_mutex must be held
+	for (int i = 0; i < STAT_COUNT; i++) {
+		out[i] = stat_retired[i];
+	}
+	for (stat_block* block : stat_blocks) {
+		for (int i = 0; i < STAT_COUNT; i++) {
+			out[i] += block->counts[i].load(std::memory_order_relaxed);
+		}
+	}
+}
+
+#define TEMPLATE_COUNT(counter) stat_count(counter)
+#else
+#define TEMPLATE_COUNT(counter) ((void)0)
+#endif
+
 static Py_ssize_t example_class_len(example_class * self);
 static PyObject* example_class_sq_item(example_class * self, Py_ssize_t index);
 static int example_class_sq_setitem(example_class * self, Py_ssize_t index, PyObject * value);
@@ -142,6 +679,8 @@ static PyObject * example_class_pow(PyObject * obj1, PyObject * obj2, PyObject *
 static PyObject * example_class_neg(example_class *obj);
 static PyObject * example_class_pos(example_class *obj);
 static PyObject * example_class_abs(example_class *obj);
+static PyObject * example_class_int(example_class *obj);
+static int example_class_bool(example_class *obj);
 static PyObject * example_class_iadd(example_class* self, PyObject *obj);
 static PyObject * example_class_isub(example_class* self, PyObject *obj);
 static PyObject * example_class_imul(example_class* self, PyObject *obj);
@@ -154,16 +693,123 @@ static PyObject * example_class_itruediv(example_class* self, PyObject *obj);
 
 static void example_class_dealloc(example_class* self);
 static PyObject* example_class_str(example_class* self);
-static PyObject* example_class_getattr(PyObject* obj, PyObject* name);
+static PyObject* example_class_repr(example_class* self);
+static Py_hash_t example_class_hash(example_class* self);
+static PyObject* example_class_get_secret(example_class* self, void* closure);
+#ifdef Py_GIL_DISABLED
+static PyObject* example_class_get_value(example_class* self, void* closure);
+static int example_class_set_value(example_class* self, PyObject* value, void* closure);
+#endif
+static PyObject* example_class_reduce(example_class* self, PyObject* unused);
 static PyObject* example_class_richcompare(example_class* self, PyObject* other, int comp_type);
 static PyObject* example_class_geniter(example_class* self);
+static int example_class_getbuffer(example_class* self, Py_buffer* view, int flags);
 static int example_class_init(example_class *self, PyObject *args, PyObject *kwds);
 static PyObject* example_class_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
 
 static void example_classIter_dealloc(example_classIter *rgstate);
 static PyObject* example_classIter_next(example_classIter *rgstate);
+static PyObject* example_classIter_length_hint(example_classIter *rgstate, PyObject* unused);
 static PyObject* example_classIter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs);
 
+static Py_ssize_t example_class_array_len(example_class_array * self);
+static PyObject* example_class_array_sq_item(example_class_array * self, Py_ssize_t index);
+static int example_class_array_sq_setitem(example_class_array * self, Py_ssize_t index, PyObject * value);
+static int example_class_array_contains(example_class_array * self, PyObject * value);
+static PyObject* example_class_array_subscript(example_class_array * self, PyObject * key);
+static int example_class_array_ass_subscript(example_class_array * self, PyObject * key, PyObject * value);
+static PyObject* example_class_array_tobytes(example_class_array * self, PyObject * unused);
+static PyObject* example_class_array_frombytes(PyObject * cls, PyObject * data);
+static PyObject* example_class_array_reduce_ex(example_class_array * self, PyObject * protocol);
+
+static void example_class_array_dealloc(example_class_array* self);
+static PyObject* example_class_array_repr(example_class_array* self);
+static int example_class_array_getbuffer(example_class_array* self, Py_buffer* view, int flags);
+static void example_class_array_releasebuffer(example_class_array* self, Py_buffer* view);
+static int example_class_array_init(example_class_array *self, PyObject *args, PyObject *kwds);
+static PyObject* example_class_array_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+static Py_ssize_t example_class_set_len(example_class_set * self);
+static int example_class_set_contains(example_class_set * self, PyObject * value);
+static PyObject* example_class_set_add(example_class_set * self, PyObject * value);
+static PyObject* example_class_set_discard(example_class_set * self, PyObject * value);
+static PyObject* example_class_set_remove(example_class_set * self, PyObject * value);
+static PyObject* example_class_set_update(example_class_set * self, PyObject * values);
+static PyObject* example_class_set_clear_method(example_class_set * self, PyObject * unused);
+static PyObject* example_class_set_to_array(example_class_set * self, PyObject * unused);
+static PyObject* example_class_set_iter(example_class_set * self);
+static PyObject* example_class_set_reduce(example_class_set * self, PyObject * unused);
+static void example_class_set_dealloc(example_class_set* self);
+static PyObject* example_class_set_repr(example_class_set* self);
+static int example_class_set_init(example_class_set *self, PyObject *args, PyObject *kwds);
+static PyObject* example_class_set_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+static Py_ssize_t example_class_map_len(example_class_map * self);
+static int example_class_map_contains(example_class_map * self, PyObject * key);
+static PyObject* example_class_map_subscript(example_class_map * self, PyObject * key);
+static int example_class_map_ass_subscript(example_class_map * self, PyObject * key, PyObject * value);
+static PyObject* example_class_map_get(example_class_map * self, FASTCALL_PARAMS);
+static PyObject* example_class_map_pop(example_class_map * self, FASTCALL_PARAMS);
+static PyObject* example_class_map_keys(example_class_map * self, PyObject * unused);
+static PyObject* example_class_map_values(example_class_map * self, PyObject * unused);
+static PyObject* example_class_map_items(example_class_map * self, PyObject * unused);
+static PyObject* example_class_map_update(example_class_map * self, PyObject * mapping);
+static PyObject* example_class_map_clear_method(example_class_map * self, PyObject * unused);
+static PyObject* example_class_map_iter(example_class_map * self);
+static PyObject* example_class_map_reduce(example_class_map * self, PyObject * unused);
+static int example_class_map_traverse(example_class_map * self, visitproc visit, void * arg);
+static int example_class_map_clear(example_class_map * self);
+static void example_class_map_dealloc(example_class_map* self);
+static PyObject* example_class_map_repr(example_class_map* self);
+static int example_class_map_init(example_class_map *self, PyObject *args, PyObject *kwds);
+static PyObject* example_class_map_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+static void example_class_tableIter_dealloc(example_class_tableIter *rgstate);
+static int example_class_tableIter_traverse(example_class_tableIter *rgstate, visitproc visit, void * arg);
+static PyObject* example_class_tableIter_next(example_class_tableIter *rgstate);
+
+static Py_ssize_t mapped_values_len(mapped_values * self);
+static PyObject* mapped_values_sq_item(mapped_values * self, Py_ssize_t index);
+static int mapped_values_sq_setitem(mapped_values * self, Py_ssize_t index, PyObject * value);
+static PyObject* mapped_values_subscript(mapped_values * self, PyObject * key);
+static PyObject* mapped_values_flush(mapped_values * self, PyObject * unused);
+static PyObject* mapped_values_advise(mapped_values * self, PyObject * hint);
+static PyObject* mapped_values_close(mapped_values * self, PyObject * unused);
+static PyObject* mapped_values_enter(mapped_values * self, PyObject * unused);
+static PyObject* mapped_values_exit(mapped_values * self, PyObject * args);
+static PyObject* mapped_values_get_mode(mapped_values * self, void * closure);
+static PyObject* mapped_values_get_closed(mapped_values * self, void * closure);
+static void mapped_values_dealloc(mapped_values* self);
+static PyObject* mapped_values_repr(mapped_values* self);
+static int mapped_values_getbuffer(mapped_values* self, Py_buffer* view, int flags);
+static void mapped_values_releasebuffer(mapped_values* self, Py_buffer* view);
+static int mapped_values_init(mapped_values *self, PyObject *args, PyObject *kwds);
+static PyObject* mapped_values_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+static PyObject* value_reader_next(value_reader *self);
+static int value_reader_traverse(value_reader * self, visitproc visit, void * arg);
+static int value_reader_clear(value_reader * self);
+static void value_reader_dealloc(value_reader* self);
+static int value_reader_init(value_reader *self, PyObject *args, PyObject *kwds);
+static PyObject* value_reader_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+static PyObject * example_class_expr_add(PyObject *obj1, PyObject *obj2);
+static PyObject * example_class_expr_sub(PyObject *obj1, PyObject *obj2);
+static PyObject * example_class_expr_mul(PyObject *obj1, PyObject *obj2);
+static PyObject * example_class_expr_mod(PyObject *obj1, PyObject *obj2);
+static PyObject * example_class_expr_pow(PyObject * obj1, PyObject * obj2, PyObject * obj3);
+static PyObject * example_class_expr_neg(PyObject *obj);
+static PyObject * example_class_expr_pos(PyObject *obj);
+static PyObject * example_class_expr_abs(PyObject *obj);
+static PyObject * example_class_expr_floordiv(PyObject *obj1, PyObject *obj2);
+static PyObject * example_class_expr_truediv(PyObject *obj1, PyObject *obj2);
+static PyObject* example_class_expr_eval(example_class_expr * self, FASTCALL_KEYWORDS_PARAMS);
+static PyObject* example_class_expr_apply(example_class_expr * self, FASTCALL_KEYWORDS_PARAMS);
+static int example_class_expr_traverse(example_class_expr * self, visitproc visit, void * arg);
+static void example_class_expr_dealloc(example_class_expr* self);
+static PyObject* example_class_expr_repr(example_class_expr* self);
+
+#if !TEMPLATE_HEAP_TYPES
 static PySequenceMethods example_classSeqMethods = {
 	/* PySequenceMethods, implementing the sequence protocol
 	 * references:
@@ -198,16 +844,16 @@ static PyNumberMethods example_classNumMethods = {
 	(unaryfunc)example_class_neg, //nb_negative
 	(unaryfunc)example_class_pos, //nb_positive
 	(unaryfunc)example_class_abs, //nb_absolute
-	0, //nb_bool
+	(inquiry)example_class_bool, //nb_bool
 	0, //nb_invert
 	0, //nb_lshift
 	0, //nb_rshift
 	0, //nb_and
 	0, //nb_xor
 	0, //nb_or
-	0, //nb_int
+	(unaryfunc)example_class_int, //nb_int
 	0, //nb_reserved
-	0, //nb_float
+	(unaryfunc)example_class_float, //nb_float
 
 	(binaryfunc)example_class_iadd, //nb_inplace_add
 	(binaryfunc)example_class_isub, //nb_inplace_subtract
@@ -244,7 +890,7 @@ static PyNumberMethods example_classNumMethods = {
 	(unaryfunc)example_class_neg, //nb_negative;
 	(unaryfunc)example_class_pos, //nb_positive;
 	(unaryfunc)example_class_abs, //nb_absolute;
-	0, //nb_nonzero;       /* Used by PyObject_IsTrue */
+	(inquiry)example_class_bool, //nb_nonzero;       /* Used by PyObject_IsTrue */
 	0, //nb_invert;
 	0, //nb_lshift;
 	0, //nb_rshift;
@@ -252,9 +898,9 @@ static PyNumberMethods example_classNumMethods = {
 	0, //nb_xor;
 	0, //nb_or;
 	0, //nb_coerce;       /* Used by the coerce() function */
-	0, //nb_int;
-	0, //nb_long;
-	0, //nb_float;
+	(unaryfunc)example_class_int, //nb_int;
+	(unaryfunc)example_class_int, //nb_long;
+	(unaryfunc)example_class_float, //nb_float;
 	0, //nb_oct;
 	0, //nb_hex;
 
@@ -279,16 +925,115 @@ static PyNumberMethods example_classNumMethods = {
 };
 #endif
 
+static PyBufferProcs example_classBufferMethods = {
+	/* PyBufferProcs, implementing the buffer protocol (PEP 3118)
+	 * references:
+	 * https://docs.python.org/3/c-api/typeobj.html#c.PyBufferProcs
+	 * https://docs.python.org/3/c-api/buffer.html
+	 */
+#if !PY3K
+	0, // bf_getreadbuffer
+	0, // bf_getwritebuffer
+	0, // bf_getsegcount
+	0, // bf_getcharbuffer
+#endif
+	(getbufferproc)example_class_getbuffer, // bf_getbuffer
+	0, // bf_releasebuffer
+};
+#endif
+
+#if PY3K
+#define Py_TPFLAGS_HAVE_NEWBUFFER 0
+#endif
+
 // example_class
 static PyMemberDef example_class_members[] = {
 	/* PyMemberDef, a structure which describes an attribute of a type which corresponds to a C struct member.
 	 * reference:
 	 * https://docs.python.org/3/c-api/structures.html#c.PyMemberDef
 	 */
+#ifndef Py_GIL_DISABLED
 	{ "value", T_DOUBLE, offsetof(example_class, value), 0, "value of example_class" },
+#endif
+	{ NULL }  /* Sentinel */
+};
+
+static PyGetSetDef example_class_getset[] = {
+	/* PyGetSetDef, a structure which describes a computed attribute of a type.
+	 * reference:
+	 * https://docs.python.org/3/c-api/structures.html#c.PyGetSetDef
+	 */
+	{ (char*)"secret", (getter)example_class_get_secret, NULL, (char*)"a secret value imported from the math module", NULL },
+#ifdef Py_GIL_DISABLED
+	// a T_DOUBLE member would read and write the value non-atomically, racing with the in-place operators
+	{ (char*)"value", (getter)example_class_get_value, (setter)TEMPLATE_LOCKED(example_class_set_value), (char*)"value of example_class", NULL },
+#endif
 	{ NULL }  /* Sentinel */
 };
 
+static PyMethodDef example_class_methods[] = {
+	{ "__reduce__", (PyCFunction)example_class_reduce, METH_NOARGS, "Return state information for pickling." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static const char example_class_doc[] = "example_class( <example_class compatible type> )\nA simple example class holding a double value.";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_class_slots[] = {
+	/* PyType_Slot, the heap type equivalent of the fields of a static PyTypeObject.
+	 * reference:
+	 * https://docs.python.org/3/c-api/type.html#c.PyType_Slot
+	 */
+	{ Py_tp_dealloc, (void*)example_class_dealloc },
+	{ Py_tp_repr, (void*)example_class_repr },
+	{ Py_tp_hash, (void*)example_class_hash },
+	{ Py_tp_str, (void*)example_class_str },
+	{ Py_tp_doc, (void*)example_class_doc },
+	{ Py_tp_richcompare, (void*)example_class_richcompare },
+	{ Py_tp_iter, (void*)example_class_geniter },
+	{ Py_tp_methods, example_class_methods },
+	{ Py_tp_members, example_class_members },
+	{ Py_tp_getset, example_class_getset },
+	{ Py_tp_init, (void*)example_class_init },
+	{ Py_tp_new, (void*)example_class_new },
+	{ Py_nb_add, (void*)example_class_add },
+	{ Py_nb_subtract, (void*)example_class_sub },
+	{ Py_nb_multiply, (void*)example_class_mul },
+	{ Py_nb_remainder, (void*)example_class_mod },
+	{ Py_nb_divmod, (void*)example_class_divmod },
+	{ Py_nb_power, (void*)example_class_pow },
+	{ Py_nb_negative, (void*)example_class_neg },
+	{ Py_nb_positive, (void*)example_class_pos },
+	{ Py_nb_absolute, (void*)example_class_abs },
+	{ Py_nb_bool, (void*)example_class_bool },
+	{ Py_nb_int, (void*)example_class_int },
+	{ Py_nb_float, (void*)example_class_float },
+	{ Py_nb_inplace_add, (void*)example_class_iadd },
+	{ Py_nb_inplace_subtract, (void*)example_class_isub },
+	{ Py_nb_inplace_multiply, (void*)example_class_imul },
+	{ Py_nb_inplace_remainder, (void*)example_class_imod },
+	{ Py_nb_inplace_power, (void*)example_class_ipow },
+	{ Py_nb_floor_divide, (void*)example_class_floordiv },
+	{ Py_nb_true_divide, (void*)example_class_truediv },
+	{ Py_nb_inplace_floor_divide, (void*)example_class_ifloordiv },
+	{ Py_nb_inplace_true_divide, (void*)example_class_itruediv },
+	{ Py_sq_length, (void*)example_class_len },
+	{ Py_sq_item, (void*)example_class_sq_item },
+	{ Py_sq_ass_item, (void*)example_class_sq_setitem },
+	{ Py_sq_contains, (void*)example_class_contains },
+	{ Py_bf_getbuffer, (void*)example_class_getbuffer },
+	{ 0, NULL }
+};
+
+static PyType_Spec example_class_spec = {
+	"template.example_class", // name
+	sizeof(example_class), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	example_class_slots, // slots
+};
+
+#else
 static PyTypeObject example_classType = {
 	/* PyTypeObject, a structure that defines a new type.
 	 * reference:
@@ -303,28 +1048,29 @@ static PyTypeObject example_classType = {
 	0,                         /* tp_getattr */
 	0,                         /* tp_setattr */
 	0,                         /* tp_reserved */
-	(reprfunc)example_class_str,                         /* tp_repr */
+	(reprfunc)example_class_repr,                         /* tp_repr */
 	&example_classNumMethods,             /* tp_as_number */
 	&example_classSeqMethods,                         /* tp_as_sequence */
 	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
+	(hashfunc)example_class_hash,                         /* tp_hash  */
 	0,                         /* tp_call */
 	(reprfunc)example_class_str,                         /* tp_str */
-	(getattrofunc)example_class_getattr,                         /* tp_getattro */
+	0,                         /* tp_getattro */
 	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
+	&example_classBufferMethods,                         /* tp_as_buffer */
 	Py_TPFLAGS_DEFAULT |
-	Py_TPFLAGS_BASETYPE,   /* tp_flags */
-	"example_class( <example_class compatible type> )\nA simple example class holding a double value.",           /* tp_doc */
+	Py_TPFLAGS_BASETYPE |
+	Py_TPFLAGS_HAVE_NEWBUFFER,   /* tp_flags */
+	example_class_doc,           /* tp_doc */
 	0,                         /* tp_traverse */
 	0,                         /* tp_clear */
 	(richcmpfunc)example_class_richcompare,                         /* tp_richcompare */
 	0,                         /* tp_weaklistoffset */
 	(getiterfunc)example_class_geniter,                         /* tp_iter */
 	0,                         /* tp_iternext */
-	0,             /* tp_methods */
+	example_class_methods,             /* tp_methods */
 	example_class_members,             /* tp_members */
-	0,           			/* tp_getset */
+	example_class_getset,           			/* tp_getset */
 	0,                         /* tp_base */
 	0,                         /* tp_dict */
 	0,                         /* tp_descr_get */
@@ -334,7 +1080,33 @@ static PyTypeObject example_classType = {
 	0,                         /* tp_alloc */
 	(newfunc)example_class_new,                 /* tp_new */
 };
+#endif
+
+static PyMethodDef example_classIter_methods[] = {
+	{ "__length_hint__", (PyCFunction)TEMPLATE_LOCKED(example_classIter_length_hint), METH_NOARGS, "Private method returning an estimate of len(list(it))." },
+	{ NULL, NULL, 0, NULL }
+};
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_classIter_slots[] = {
+	{ Py_tp_dealloc, (void*)example_classIter_dealloc },
+	{ Py_tp_doc, (void*)"example_class iterator" },
+	{ Py_tp_iter, (void*)PyObject_SelfIter },
+	{ Py_tp_iternext, (void*)TEMPLATE_LOCKED(example_classIter_next) },
+	{ Py_tp_methods, example_classIter_methods },
+	{ Py_tp_new, (void*)example_classIter_new },
+	{ 0, NULL }
+};
+
+static PyType_Spec example_classIter_spec = {
+	"template.example_classIter", // name
+	sizeof(example_classIter), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	example_classIter_slots, // slots
+};
 
+#else
 static PyTypeObject example_classIterType = {
 	PyVarObject_HEAD_INIT(NULL, 0)
 	"example_classIter",             /* tp_name */
@@ -361,9 +1133,9 @@ static PyTypeObject example_classIterType = {
 	0,                         /* tp_clear */
 	0,                         /* tp_richcompare */
 	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
+	PyObject_SelfIter,                         /* tp_iter */
 	(iternextfunc)example_classIter_next,                         /* tp_iternext */
-	0,             /* tp_methods */
+	example_classIter_methods,             /* tp_methods */
 	0,             /* tp_members */
 	0,           			/* tp_getset */
 	0,                         /* tp_base */
@@ -375,610 +1147,7103 @@ static PyTypeObject example_classIterType = {
 	0,                         /* tp_alloc */
 	(newfunc)example_classIter_new,                 /* tp_new */
 };
+#endif
 
-static PyObject* pack_example_class(double value) {
-	example_class* out = (example_class*)example_classType.tp_alloc(&example_classType, 0);
-
-	if (out != NULL) {
-		out->value = value;
-	}
-
-	return (PyObject*)out;
-}
-
-static bool unpack_example_class(PyObject * op, internal_example_class* out) {
-	if (PyObject_TypeCheck(op, &example_classType)) {
-		out->value = ((example_class*)op)->value;
-		return true;
-	}
-	if (PyExtNumber_Check(op)) {
-		out->value = PyExtNumber_AsDouble(op);
-		return true;
-	}
-	return false;
+// example_class_array
+#if !TEMPLATE_HEAP_TYPES
+static PySequenceMethods example_class_arraySeqMethods = {
+	(lenfunc)example_class_array_len, // sq_length
+	0, // sq_concat
+	0, // sq_repeat
+	(ssizeargfunc)example_class_array_sq_item, // sq_item
+	0,
+	(ssizeobjargproc)example_class_array_sq_setitem, // sq_ass_item
+	0,
+	(objobjproc)example_class_array_contains, // sq_contains
+	0, // sq_inplace_concat
+	0, // sq_inplace_repeat
+};
 
-}
+static PyMappingMethods example_class_arrayMapMethods = {
+	/* PyMappingMethods, used here to support slicing
+	 * reference:
+	 * https://docs.python.org/3/c-api/typeobj.html#c.PyMappingMethods
+	 */
+	(lenfunc)example_class_array_len, // mp_length
+	(binaryfunc)example_class_array_subscript, // mp_subscript
+	(objobjargproc)example_class_array_ass_subscript, // mp_ass_subscript
+};
+#endif
 
-static void
-example_class_dealloc(example_class* self)
-{
-	Py_TYPE(self)->tp_free((PyObject*)self);
-}
+static PyMethodDef example_class_array_methods[] = {
+	{ "tobytes", (PyCFunction)TEMPLATE_LOCKED(example_class_array_tobytes), METH_NOARGS, "tobytes() -> bytes\nReturns the values as little-endian IEEE 754 doubles." },
+	{ "frombytes", (PyCFunction)example_class_array_frombytes, METH_O | METH_CLASS, "frombytes(data) -> example_class_array\nCreates an array from a buffer of little-endian IEEE 754 doubles." },
+	{ "__reduce_ex__", (PyCFunction)TEMPLATE_LOCKED(example_class_array_reduce_ex), METH_O, "Return state information for pickling, protocol 5 passes the data out-of-band." },
+	{ NULL, NULL, 0, NULL }
+};
 
-static PyObject *
-example_class_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
-{
-	example_class *self;
+#if !TEMPLATE_HEAP_TYPES
+static PyBufferProcs example_class_arrayBufferMethods = {
+#if !PY3K
+	0, // bf_getreadbuffer
+	0, // bf_getwritebuffer
+	0, // bf_getsegcount
+	0, // bf_getcharbuffer
+#endif
+	(getbufferproc)example_class_array_getbuffer, // bf_getbuffer
+	(releasebufferproc)example_class_array_releasebuffer, // bf_releasebuffer
+};
+#endif
 
-	self = (example_class *)type->tp_alloc(type, 0);
-	if (self != NULL) {
-		self->value = 0.0;
-	}
+static const char example_class_array_doc[] = "example_class_array( <iterable of example_class compatible types> )\nAn array of double values stored in one contiguous buffer.";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_class_array_slots[] = {
+	{ Py_tp_dealloc, (void*)example_class_array_dealloc },
+	{ Py_tp_repr, (void*)TEMPLATE_LOCKED(example_class_array_repr) },
+	{ Py_tp_doc, (void*)example_class_array_doc },
+	{ Py_tp_methods, example_class_array_methods },
+	{ Py_tp_init, (void*)TEMPLATE_LOCKED(example_class_array_init) },
+	{ Py_tp_new, (void*)example_class_array_new },
+	{ Py_sq_length, (void*)TEMPLATE_LOCKED(example_class_array_len) },
+	{ Py_sq_item, (void*)TEMPLATE_LOCKED(example_class_array_sq_item) },
+	{ Py_sq_ass_item, (void*)TEMPLATE_LOCKED(example_class_array_sq_setitem) },
+	{ Py_sq_contains, (void*)TEMPLATE_LOCKED(example_class_array_contains) },
+	{ Py_mp_length, (void*)TEMPLATE_LOCKED(example_class_array_len) },
+	{ Py_mp_subscript, (void*)TEMPLATE_LOCKED(example_class_array_subscript) },
+	{ Py_mp_ass_subscript, (void*)TEMPLATE_LOCKED(example_class_array_ass_subscript) },
+	{ Py_bf_getbuffer, (void*)TEMPLATE_LOCKED(example_class_array_getbuffer) },
+	{ Py_bf_releasebuffer, (void*)TEMPLATE_LOCKED(example_class_array_releasebuffer) },
+	{ 0, NULL }
+};
 
-	return (PyObject *)self;
-}
+static PyType_Spec example_class_array_spec = {
+	"template.example_class_array", // name
+	sizeof(example_class_array), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	example_class_array_slots, // slots
+};
 
-static int
+#else
+static PyTypeObject example_class_arrayType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"template.example_class_array",             /* tp_name */
+	sizeof(example_class_array),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)example_class_array_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	(reprfunc)example_class_array_repr,                         /* tp_repr */
+	0,             /* tp_as_number */
+	&example_class_arraySeqMethods,                         /* tp_as_sequence */
+	&example_class_arrayMapMethods,                         /* tp_as_mapping */
+	0,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	&example_class_arrayBufferMethods,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_BASETYPE |
+	Py_TPFLAGS_HAVE_NEWBUFFER,   /* tp_flags */
+	example_class_array_doc,           /* tp_doc */
+	0,                         /* tp_traverse */
+	0,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	0,                         /* tp_iter */
+	0,                         /* tp_iternext */
+	example_class_array_methods,             /* tp_methods */
+	0,             /* tp_members */
+	0,           			/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)example_class_array_init,      /* tp_init */
+	0,                         /* tp_alloc */
+	(newfunc)example_class_array_new,                 /* tp_new */
+};
+#endif
+
+// example_class_set / example_class_map
+static PyMethodDef example_class_set_methods[] = {
+	{ "add", (PyCFunction)TEMPLATE_LOCKED(example_class_set_add), METH_O, "add(value)\nAdds a value to the set." },
+	{ "discard", (PyCFunction)TEMPLATE_LOCKED(example_class_set_discard), METH_O, "discard(value)\nRemoves a value from the set if it is a member." },
+	{ "remove", (PyCFunction)TEMPLATE_LOCKED(example_class_set_remove), METH_O, "remove(value)\nRemoves a value from the set, raises KeyError if it is not a member." },
+	{ "update", (PyCFunction)TEMPLATE_LOCKED(example_class_set_update), METH_O, "update(values)\nAdds all values of a buffer or iterable to the set." },
+	{ "clear", (PyCFunction)TEMPLATE_LOCKED(example_class_set_clear_method), METH_NOARGS, "clear()\nRemoves all values from the set." },
+	{ "to_array", (PyCFunction)TEMPLATE_LOCKED(example_class_set_to_array), METH_NOARGS, "to_array() -> example_class_array\nReturns the members of the set as an example_class_array." },
+	{ "__reduce__", (PyCFunction)TEMPLATE_LOCKED(example_class_set_reduce), METH_NOARGS, "Return state information for pickling." },
+	{ NULL, NULL, 0, NULL }
+};
+
+#if !TEMPLATE_HEAP_TYPES
+static PySequenceMethods example_class_setSeqMethods = {
+	(lenfunc)example_class_set_len, // sq_length
+	0, // sq_concat
+	0, // sq_repeat
+	0, // sq_item
+	0,
+	0, // sq_ass_item
+	0,
+	(objobjproc)example_class_set_contains, // sq_contains
+	0, // sq_inplace_concat
+	0, // sq_inplace_repeat
+};
+#endif
+
+static const char example_class_set_doc[] = "example_class_set( <iterable of example_class compatible types> )\nA set of double values, stored inline in an open addressing hash table.";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_class_set_slots[] = {
+	{ Py_tp_dealloc, (void*)example_class_set_dealloc },
+	{ Py_tp_repr, (void*)TEMPLATE_LOCKED(example_class_set_repr) },
+	{ Py_tp_hash, (void*)PyObject_HashNotImplemented },
+	{ Py_tp_doc, (void*)example_class_set_doc },
+	{ Py_tp_iter, (void*)TEMPLATE_LOCKED(example_class_set_iter) },
+	{ Py_tp_methods, example_class_set_methods },
+	{ Py_tp_init, (void*)TEMPLATE_LOCKED(example_class_set_init) },
+	{ Py_tp_new, (void*)example_class_set_new },
+	{ Py_sq_length, (void*)TEMPLATE_LOCKED(example_class_set_len) },
+	{ Py_sq_contains, (void*)TEMPLATE_LOCKED(example_class_set_contains) },
+	{ 0, NULL }
+};
+
+static PyType_Spec example_class_set_spec = {
+	"template.example_class_set", // name
+	sizeof(example_class_set), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	example_class_set_slots, // slots
+};
+
+#else
+static PyTypeObject example_class_setType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"template.example_class_set",             /* tp_name */
+	sizeof(example_class_set),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)example_class_set_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	(reprfunc)example_class_set_repr,                         /* tp_repr */
+	0,             /* tp_as_number */
+	&example_class_setSeqMethods,                         /* tp_as_sequence */
+	0,                         /* tp_as_mapping */
+	PyObject_HashNotImplemented,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	0,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_BASETYPE,   /* tp_flags */
+	example_class_set_doc,           /* tp_doc */
+	0,                         /* tp_traverse */
+	0,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	(getiterfunc)example_class_set_iter,                         /* tp_iter */
+	0,                         /* tp_iternext */
+	example_class_set_methods,             /* tp_methods */
+	0,             /* tp_members */
+	0,           			/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)example_class_set_init,      /* tp_init */
+	0,                         /* tp_alloc */
+	(newfunc)example_class_set_new,                 /* tp_new */
+};
+#endif
+
+static PyMethodDef example_class_map_methods[] = {
+	{ "get", (PyCFunction)TEMPLATE_LOCKED(example_class_map_get), METH_FASTCALL_COMPAT, "get(key, default=None)\nReturns the value for key, or default if key is not in the map." },
+	{ "pop", (PyCFunction)TEMPLATE_LOCKED(example_class_map_pop), METH_FASTCALL_COMPAT, "pop(key[, default])\nRemoves key and returns its value, or default if key is not in the map." },
+	{ "keys", (PyCFunction)TEMPLATE_LOCKED(example_class_map_keys), METH_NOARGS, "keys() -> list\nReturns a list of the keys, as example_class like iter(map)." },
+	{ "values", (PyCFunction)TEMPLATE_LOCKED(example_class_map_values), METH_NOARGS, "values() -> list\nReturns a list of the values." },
+	{ "items", (PyCFunction)TEMPLATE_LOCKED(example_class_map_items), METH_NOARGS, "items() -> list\nReturns a list of (key, value) tuples, with example_class keys." },
+	{ "update", (PyCFunction)TEMPLATE_LOCKED(example_class_map_update), METH_O, "update(mapping)\nInserts all items of a mapping." },
+	{ "clear", (PyCFunction)TEMPLATE_LOCKED(example_class_map_clear_method), METH_NOARGS, "clear()\nRemoves all items." },
+	{ "__reduce__", (PyCFunction)TEMPLATE_LOCKED(example_class_map_reduce), METH_NOARGS, "Return state information for pickling." },
+	{ NULL, NULL, 0, NULL }
+};
+
+#if !TEMPLATE_HEAP_TYPES
+static PySequenceMethods example_class_mapSeqMethods = {
+	0, // sq_length
+	0, // sq_concat
+	0, // sq_repeat
+	0, // sq_item
+	0,
+	0, // sq_ass_item
+	0,
+	(objobjproc)example_class_map_contains, // sq_contains
+	0, // sq_inplace_concat
+	0, // sq_inplace_repeat
+};
+
+static PyMappingMethods example_class_mapMapMethods = {
+	(lenfunc)example_class_map_len, // mp_length
+	(binaryfunc)example_class_map_subscript, // mp_subscript
+	(objobjargproc)example_class_map_ass_subscript, // mp_ass_subscript
+};
+#endif
+
+static const char example_class_map_doc[] = "example_class_map( <mapping with example_class compatible keys> )\nA mapping from double values to objects, with the keys stored inline in an open addressing hash table.";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_class_map_slots[] = {
+	{ Py_tp_dealloc, (void*)example_class_map_dealloc },
+	{ Py_tp_repr, (void*)TEMPLATE_LOCKED(example_class_map_repr) },
+	{ Py_tp_hash, (void*)PyObject_HashNotImplemented },
+	{ Py_tp_doc, (void*)example_class_map_doc },
+	{ Py_tp_traverse, (void*)example_class_map_traverse },
+	{ Py_tp_clear, (void*)example_class_map_clear },
+	{ Py_tp_iter, (void*)TEMPLATE_LOCKED(example_class_map_iter) },
+	{ Py_tp_methods, example_class_map_methods },
+	{ Py_tp_init, (void*)TEMPLATE_LOCKED(example_class_map_init) },
+	{ Py_tp_new, (void*)example_class_map_new },
+	{ Py_sq_contains, (void*)TEMPLATE_LOCKED(example_class_map_contains) },
+	{ Py_mp_length, (void*)TEMPLATE_LOCKED(example_class_map_len) },
+	{ Py_mp_subscript, (void*)TEMPLATE_LOCKED(example_class_map_subscript) },
+	{ Py_mp_ass_subscript, (void*)TEMPLATE_LOCKED(example_class_map_ass_subscript) },
+	{ 0, NULL }
+};
+
+static PyType_Spec example_class_map_spec = {
+	"template.example_class_map", // name
+	sizeof(example_class_map), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	example_class_map_slots, // slots
+};
+
+#else
+static PyTypeObject example_class_mapType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"template.example_class_map",             /* tp_name */
+	sizeof(example_class_map),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)example_class_map_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	(reprfunc)example_class_map_repr,                         /* tp_repr */
+	0,             /* tp_as_number */
+	&example_class_mapSeqMethods,                         /* tp_as_sequence */
+	&example_class_mapMapMethods,                         /* tp_as_mapping */
+	PyObject_HashNotImplemented,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	0,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_BASETYPE |
+	Py_TPFLAGS_HAVE_GC,   /* tp_flags */
+	example_class_map_doc,           /* tp_doc */
+	(traverseproc)example_class_map_traverse,                         /* tp_traverse */
+	(inquiry)example_class_map_clear,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	(getiterfunc)example_class_map_iter,                         /* tp_iter */
+	0,                         /* tp_iternext */
+	example_class_map_methods,             /* tp_methods */
+	0,             /* tp_members */
+	0,           			/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)example_class_map_init,      /* tp_init */
+	0,                         /* tp_alloc */
+	(newfunc)example_class_map_new,                 /* tp_new */
+};
+#endif
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_class_tableIter_slots[] = {
+	{ Py_tp_dealloc, (void*)example_class_tableIter_dealloc },
+	{ Py_tp_doc, (void*)"example_class_set / example_class_map iterator" },
+	{ Py_tp_traverse, (void*)example_class_tableIter_traverse },
+	{ Py_tp_iter, (void*)PyObject_SelfIter },
+	{ Py_tp_iternext, (void*)example_class_tableIter_next },
+	{ 0, NULL }
+};
+
+static PyType_Spec example_class_tableIter_spec = {
+	"template.example_class_tableIter", // name
+	sizeof(example_class_tableIter), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE_COMPAT | Py_TPFLAGS_DISALLOW_INSTANTIATION_COMPAT, // flags
+	example_class_tableIter_slots, // slots
+};
+
+#else
+static PyTypeObject example_class_tableIterType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"example_class_tableIter",             /* tp_name */
+	sizeof(example_class_tableIter),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)example_class_tableIter_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	0,                         /* tp_repr */
+	0,             /* tp_as_number */
+	0,                         /* tp_as_sequence */
+	0,                         /* tp_as_mapping */
+	0,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	0,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_HAVE_GC,   /* tp_flags */
+	"example_class_set / example_class_map iterator",           /* tp_doc */
+	(traverseproc)example_class_tableIter_traverse,                         /* tp_traverse */
+	0,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	PyObject_SelfIter,                         /* tp_iter */
+	(iternextfunc)example_class_tableIter_next,                         /* tp_iternext */
+};
+#endif
+
+// mapped_values
+#if !TEMPLATE_HEAP_TYPES
+static PySequenceMethods mapped_valuesSeqMethods = {
+	(lenfunc)mapped_values_len, // sq_length
+	0, // sq_concat
+	0, // sq_repeat
+	(ssizeargfunc)mapped_values_sq_item, // sq_item
+	0,
+	(ssizeobjargproc)mapped_values_sq_setitem, // sq_ass_item
+	0,
+	0, // sq_contains
+	0, // sq_inplace_concat
+	0, // sq_inplace_repeat
+};
+
+static PyMappingMethods mapped_valuesMapMethods = {
+	(lenfunc)mapped_values_len, // mp_length
+	(binaryfunc)mapped_values_subscript, // mp_subscript
+	0, // mp_ass_subscript
+};
+
+static PyBufferProcs mapped_valuesBufferMethods = {
+#if !PY3K
+	0, // bf_getreadbuffer
+	0, // bf_getwritebuffer
+	0, // bf_getsegcount
+	0, // bf_getcharbuffer
+#endif
+	(getbufferproc)mapped_values_getbuffer, // bf_getbuffer
+	(releasebufferproc)mapped_values_releasebuffer, // bf_releasebuffer
+};
+#endif
+
+static PyMethodDef mapped_values_methods[] = {
+	{ "flush", (PyCFunction)TEMPLATE_LOCKED(mapped_values_flush), METH_NOARGS, "flush()\nWrites changes of a mode 'r+' mapping back to the file (msync)." },
+	{ "advise", (PyCFunction)TEMPLATE_LOCKED(mapped_values_advise), METH_O, "advise(hint)\nTells the OS how the values will be accessed: 'normal', 'sequential', 'random', 'willneed' or 'dontneed' (madvise)." },
+	{ "close", (PyCFunction)TEMPLATE_LOCKED(mapped_values_close), METH_NOARGS, "close()\nUnmaps the file, without flushing it first." },
+	{ "__enter__", (PyCFunction)mapped_values_enter, METH_NOARGS, NULL },
+	{ "__exit__", (PyCFunction)TEMPLATE_LOCKED(mapped_values_exit), METH_VARARGS, NULL },
+	{ NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef mapped_values_getset[] = {
+	{ (char*)"mode", (getter)TEMPLATE_LOCKED(mapped_values_get_mode), NULL, (char*)"'r' (read-only), 'c' (copy-on-write) or 'r+' (read-write)", NULL },
+	{ (char*)"closed", (getter)TEMPLATE_LOCKED(mapped_values_get_closed), NULL, (char*)"whether the file has been unmapped", NULL },
+	{ NULL }  /* Sentinel */
+};
+
+static const char mapped_values_doc[] = "mapped_values(path, mode='r')\nA file of doubles (raw, or written by template.dumps()) mapped into memory.\nmode is 'r' (read-only), 'c' (copy-on-write) or 'r+' (read-write).";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot mapped_values_slots[] = {
+	{ Py_tp_dealloc, (void*)mapped_values_dealloc },
+	{ Py_tp_repr, (void*)TEMPLATE_LOCKED(mapped_values_repr) },
+	{ Py_tp_doc, (void*)mapped_values_doc },
+	{ Py_tp_methods, mapped_values_methods },
+	{ Py_tp_getset, mapped_values_getset },
+	{ Py_tp_init, (void*)TEMPLATE_LOCKED(mapped_values_init) },
+	{ Py_tp_new, (void*)mapped_values_new },
+	{ Py_sq_length, (void*)TEMPLATE_LOCKED(mapped_values_len) },
+	{ Py_sq_item, (void*)TEMPLATE_LOCKED(mapped_values_sq_item) },
+	{ Py_sq_ass_item, (void*)TEMPLATE_LOCKED(mapped_values_sq_setitem) },
+	{ Py_mp_length, (void*)TEMPLATE_LOCKED(mapped_values_len) },
+	{ Py_mp_subscript, (void*)TEMPLATE_LOCKED(mapped_values_subscript) },
+	{ Py_bf_getbuffer, (void*)TEMPLATE_LOCKED(mapped_values_getbuffer) },
+	{ Py_bf_releasebuffer, (void*)TEMPLATE_LOCKED(mapped_values_releasebuffer) },
+	{ 0, NULL }
+};
+
+static PyType_Spec mapped_values_spec = {
+	"template.mapped_values", // name
+	sizeof(mapped_values), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	mapped_values_slots, // slots
+};
+
+#else
+static PyTypeObject mapped_valuesType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"template.mapped_values",             /* tp_name */
+	sizeof(mapped_values),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)mapped_values_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	(reprfunc)mapped_values_repr,                         /* tp_repr */
+	0,             /* tp_as_number */
+	&mapped_valuesSeqMethods,                         /* tp_as_sequence */
+	&mapped_valuesMapMethods,                         /* tp_as_mapping */
+	0,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	&mapped_valuesBufferMethods,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_HAVE_NEWBUFFER,   /* tp_flags */
+	mapped_values_doc,           /* tp_doc */
+	0,                         /* tp_traverse */
+	0,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	0,                         /* tp_iter */
+	0,                         /* tp_iternext */
+	mapped_values_methods,             /* tp_methods */
+	0,             /* tp_members */
+	mapped_values_getset,           			/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)mapped_values_init,      /* tp_init */
+	0,                         /* tp_alloc */
+	(newfunc)mapped_values_new,                 /* tp_new */
+};
+#endif
+
+// value_reader
+static const char value_reader_doc[] = "value_reader(source, chunk_size=65536, binary=False, reuse=False)\nIterates over the values of a file descriptor, file object or iterator of str/bytes blocks\nin example_class_array chunks of at most chunk_size values.\nText input holds decimal floats separated by whitespace or commas, binary input holds little-endian doubles.\nWith reuse=True, each chunk overwrites the previous one (unless its buffer is exported).";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot value_reader_slots[] = {
+	{ Py_tp_dealloc, (void*)value_reader_dealloc },
+	{ Py_tp_doc, (void*)value_reader_doc },
+	{ Py_tp_traverse, (void*)value_reader_traverse },
+	{ Py_tp_clear, (void*)value_reader_clear },
+	{ Py_tp_iter, (void*)PyObject_SelfIter },
+	{ Py_tp_iternext, (void*)TEMPLATE_LOCKED(value_reader_next) },
+	{ Py_tp_init, (void*)TEMPLATE_LOCKED(value_reader_init) },
+	{ Py_tp_new, (void*)value_reader_new },
+	{ 0, NULL }
+};
+
+static PyType_Spec value_reader_spec = {
+	"template.value_reader", // name
+	sizeof(value_reader), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	value_reader_slots, // slots
+};
+
+#else
+static PyTypeObject value_readerType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"template.value_reader",             /* tp_name */
+	sizeof(value_reader),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)value_reader_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	0,                         /* tp_repr */
+	0,             /* tp_as_number */
+	0,                         /* tp_as_sequence */
+	0,                         /* tp_as_mapping */
+	0,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	0,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_HAVE_GC,   /* tp_flags */
+	value_reader_doc,           /* tp_doc */
+	(traverseproc)value_reader_traverse,                         /* tp_traverse */
+	(inquiry)value_reader_clear,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	PyObject_SelfIter,                         /* tp_iter */
+	(iternextfunc)value_reader_next,                         /* tp_iternext */
+	0,             /* tp_methods */
+	0,             /* tp_members */
+	0,           			/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)value_reader_init,      /* tp_init */
+	0,                         /* tp_alloc */
+	(newfunc)value_reader_new,                 /* tp_new */
+};
+#endif
+
+// example_class_expr
+#if !TEMPLATE_HEAP_TYPES
+#if PY3K
+static PyNumberMethods example_class_exprNumMethods = {
+	(binaryfunc)example_class_expr_add,
+	(binaryfunc)example_class_expr_sub,
+	(binaryfunc)example_class_expr_mul,
+	(binaryfunc)example_class_expr_mod, //nb_remainder
+	0, //nb_divmod
+	(ternaryfunc)example_class_expr_pow, //nb_power
+	(unaryfunc)example_class_expr_neg, //nb_negative
+	(unaryfunc)example_class_expr_pos, //nb_positive
+	(unaryfunc)example_class_expr_abs, //nb_absolute
+	0, //nb_bool
+	0, //nb_invert
+	0, //nb_lshift
+	0, //nb_rshift
+	0, //nb_and
+	0, //nb_xor
+	0, //nb_or
+	0, //nb_int
+	0, //nb_reserved
+	0, //nb_float, deliberately missing: example_class operands would otherwise evaluate expressions eagerly
+
+	0, //nb_inplace_add
+	0, //nb_inplace_subtract
+	0, //nb_inplace_multiply
+	0, //nb_inplace_remainder
+	0, //nb_inplace_power
+	0, //nb_inplace_lshift
+	0, //nb_inplace_rshift
+	0, //nb_inplace_and
+	0, //nb_inplace_xor
+	0, //nb_inplace_or
+
+	(binaryfunc)example_class_expr_floordiv, //nb_floor_divide
+	(binaryfunc)example_class_expr_truediv,
+	0, //nb_inplace_floor_divide
+	0, //nb_inplace_true_divide
+
+	0, //nb_index
+};
+#else
+static PyNumberMethods example_class_exprNumMethods = {
+	(binaryfunc)example_class_expr_add, //nb_add;
+	(binaryfunc)example_class_expr_sub, //nb_subtract;
+	(binaryfunc)example_class_expr_mul, //nb_multiply;
+	(binaryfunc)example_class_expr_truediv, //nb_divide;
+	(binaryfunc)example_class_expr_mod, //nb_remainder;
+	0, //nb_divmod;
+	(ternaryfunc)example_class_expr_pow, //nb_power;
+	(unaryfunc)example_class_expr_neg, //nb_negative;
+	(unaryfunc)example_class_expr_pos, //nb_positive;
+	(unaryfunc)example_class_expr_abs, //nb_absolute;
+	0, //nb_nonzero;
+	0, //nb_invert;
+	0, //nb_lshift;
+	0, //nb_rshift;
+	0, //nb_and;
+	0, //nb_xor;
+	0, //nb_or;
+	0, //nb_coerce;
+	0, //nb_int;
+	0, //nb_long;
+	0, //nb_float;
+	0, //nb_oct;
+	0, //nb_hex;
+
+	0, //nb_inplace_add;
+	0, //nb_inplace_subtract;
+	0, //nb_inplace_multiply;
+	0, //nb_inplace_divide;
+	0, //nb_inplace_remainder;
+	0, //nb_inplace_power;
+	0, //nb_inplace_lshift;
+	0, //nb_inplace_rshift;
+	0, //nb_inplace_and;
+	0, //nb_inplace_xor;
+	0, //nb_inplace_or;
+
+	(binaryfunc)example_class_expr_floordiv, //nb_floor_divide;
+	(binaryfunc)example_class_expr_truediv, //nb_true_divide;
+	0, //nb_inplace_floor_divide;
+	0, //nb_inplace_true_divide;
+};
+#endif
+#endif
+
+static PyMethodDef example_class_expr_methods[] = {
+	{ "eval", (PyCFunction)TEMPLATE_LOCKED(example_class_expr_eval), METH_FASTCALL_COMPAT | METH_KEYWORDS, "eval(out=None) -> example_class or example_class_array\nEvaluates the expression in a single pass. The result is an array if any operand is one." },
+	{ "apply", (PyCFunction)TEMPLATE_LOCKED(example_class_expr_apply), METH_FASTCALL_COMPAT | METH_KEYWORDS, "apply(values, out=None) -> example_class or example_class_array\nEvaluates the expression with the template.lazy() placeholder bound to values." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static const char example_class_expr_doc[] = "A lazily evaluated arithmetic expression, created by template.lazy().\nOperators record the expression instead of computing it, eval() computes it in one pass.";
+
+#if TEMPLATE_HEAP_TYPES
+static PyType_Slot example_class_expr_slots[] = {
+	{ Py_tp_dealloc, (void*)example_class_expr_dealloc },
+	{ Py_tp_repr, (void*)example_class_expr_repr },
+	{ Py_tp_doc, (void*)example_class_expr_doc },
+	{ Py_tp_traverse, (void*)example_class_expr_traverse },
+	{ Py_tp_methods, example_class_expr_methods },
+	{ Py_nb_add, (void*)example_class_expr_add },
+	{ Py_nb_subtract, (void*)example_class_expr_sub },
+	{ Py_nb_multiply, (void*)example_class_expr_mul },
+	{ Py_nb_remainder, (void*)example_class_expr_mod },
+	{ Py_nb_power, (void*)example_class_expr_pow },
+	{ Py_nb_negative, (void*)example_class_expr_neg },
+	{ Py_nb_positive, (void*)example_class_expr_pos },
+	{ Py_nb_absolute, (void*)example_class_expr_abs },
+	{ Py_nb_floor_divide, (void*)example_class_expr_floordiv },
+	{ Py_nb_true_divide, (void*)example_class_expr_truediv },
+	{ 0, NULL } // no Py_nb_float: example_class operands would otherwise evaluate expressions eagerly
+};
+
+static PyType_Spec example_class_expr_spec = {
+	"template.example_class_expr", // name
+	sizeof(example_class_expr), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE_COMPAT | Py_TPFLAGS_DISALLOW_INSTANTIATION_COMPAT, // flags
+	example_class_expr_slots, // slots
+};
+
+#else
+static PyTypeObject example_class_exprType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"template.example_class_expr",             /* tp_name */
+	sizeof(example_class_expr),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)example_class_expr_dealloc, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	(reprfunc)example_class_expr_repr,                         /* tp_repr */
+	&example_class_exprNumMethods,             /* tp_as_number */
+	0,                         /* tp_as_sequence */
+	0,                         /* tp_as_mapping */
+	0,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	0,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_CHECKTYPES |
+	Py_TPFLAGS_HAVE_GC,   /* tp_flags */
+	example_class_expr_doc,           /* tp_doc */
+	(traverseproc)example_class_expr_traverse,                         /* tp_traverse */
+	0,                         /* tp_clear */
+	0,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	0,                         /* tp_iter */
+	0,                         /* tp_iternext */
+	example_class_expr_methods,             /* tp_methods */
+};
+#endif
+
+// float formatting
+/* Formats doubles the way float.__repr__ does (shortest string that round-trips), without allocating.
+ * The shortest digits come from std::to_chars where the standard library implements it for doubles,
+ * otherwise from the smallest %.*e precision that reads back as the same value.
+ * With <single>, the digits are the shortest ones that round-trip through a float (for example_class_f32).
+ */
+#define FORMAT_DOUBLE_MAX 32 // enough for any repr(float), plus the terminating null byte
+
+static int double_shortest_digits(double value, char* digits, int* exponent, bool single) {
+	// writes the shortest round-trip digits of the finite, positive <value> to <digits>, returns their count
+	char buf[FORMAT_DOUBLE_MAX];
+	int length;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	if (single) {
+		length = (int)(std::to_chars(buf, buf + sizeof(buf) - 1, (float)value, std::chars_format::scientific).ptr - buf);
+	}
+	else {
+		length = (int)(std::to_chars(buf, buf + sizeof(buf) - 1, value, std::chars_format::scientific).ptr - buf);
+	}
+	buf[length] = '\0';
+#else
+	// any 15 (6 for floats) significant digits round-trip, except for subnormal values which have fewer bits
+	for (int precision = (value < (single ? FLT_MIN : DBL_MIN)) ? 1 : single ? 6 : 15;; precision++) {
+		length = snprintf(buf, sizeof(buf), "%.*e", precision - 1, value);
+		if (precision == (single ? 9 : 17) || (single ? strtof(buf, NULL) == (float)value : strtod(buf, NULL) == value)) {
+			break;
+		}
+	}
+#endif
+	// buf is "d[.ddd]e(+|-)xx"
+	int count = 0;
+	int i = 0;
+	for (; i < length && buf[i] != 'e'; i++) {
+		if (buf[i] != '.') {
+			digits[count++] = buf[i];
+		}
+	}
+	*exponent = atoi(buf + i + 1);
+	while (count > 1 && digits[count - 1] == '0') {
+		count--;
+	}
+	return count;
+}
+
+static int format_double(double value, char* out, bool single = false) {
+	// writes repr(float(<value>)) to <out> (at least FORMAT_DOUBLE_MAX bytes), returns its length
+	char* p = out;
+	if (value != value) {
+		memcpy(out, "nan", 4);
+		return 3;
+	}
+	if (signbit(value)) {
+		*p++ = '-';
+		value = -value;
+	}
+	if (value == HUGE_VAL) {
+		memcpy(p, "inf", 4);
+		return (int)(p - out) + 3;
+	}
+	if (value == 0.0) {
+		memcpy(p, "0.0", 4);
+		return (int)(p - out) + 3;
+	}
+	char digits[FORMAT_DOUBLE_MAX];
+	int exponent;
+	int count = double_shortest_digits(value, digits, &exponent, single);
+	int point = exponent + 1; // position of the decimal point relative to the digits
+	if (-4 < point && point <= 16) {
+		// same thresholds as float.__repr__: fixed notation for 1e-4 <= |value| < 1e16
+		if (point <= 0) {
+			*p++ = '0';
+			*p++ = '.';
+			for (int i = point; i < 0; i++) {
+				*p++ = '0';
+			}
+			memcpy(p, digits, count);
+			p += count;
+		}
+		else if (point >= count) {
+			memcpy(p, digits, count);
+			p += count;
+			for (int i = count; i < point; i++) {
+				*p++ = '0';
+			}
+			*p++ = '.';
+			*p++ = '0';
+		}
+		else {
+			memcpy(p, digits, point);
+			p += point;
+			*p++ = '.';
+			memcpy(p, digits + point, count - point);
+			p += count - point;
+		}
+	}
+	else {
+		*p++ = digits[0];
+		if (count > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, count - 1);
+			p += count - 1;
+		}
+		p += snprintf(p, 8, "e%c%02d", (exponent < 0) ? '-' : '+', abs(exponent));
+	}
+	*p = '\0';
+	return (int)(p - out);
+}
+
+static PyObject* format_doubles(const char* prefix, const double* data, Py_ssize_t length, const char* sep, Py_ssize_t sep_length, const char* suffix, bool release_gil) {
+	/* Returns prefix + sep.join(repr(value) for value in data) + suffix as a str, built in a single buffer.
+	 * Only pass <release_gil> if <data> can't change in the meantime (e.g. it's held by a buffer view).
+	 */
+	size_t prefix_length = strlen(prefix);
+	size_t suffix_length = strlen(suffix);
+	if ((size_t)length > (PY_SSIZE_T_MAX - prefix_length - suffix_length) / (FORMAT_DOUBLE_MAX + (size_t)sep_length)) {
+		return PyErr_NoMemory();
+	}
+	char* buf = (char*)PyMem_Malloc(prefix_length + (size_t)length * (FORMAT_DOUBLE_MAX + (size_t)sep_length) + suffix_length + 1);
+	if (buf == NULL) {
+		return PyErr_NoMemory();
+	}
+	char* p = buf;
+	memcpy(p, prefix, prefix_length);
+	p += prefix_length;
+	auto format = [&] {
+		for (Py_ssize_t i = 0; i < length; i++) {
+			if (i > 0) {
+				memcpy(p, sep, (size_t)sep_length);
+				p += sep_length;
+			}
+			p += format_double(data[i], p);
+		}
+	};
+	if (release_gil) {
+		Py_BEGIN_ALLOW_THREADS
+		format();
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		format();
+	}
+	memcpy(p, suffix, suffix_length);
+	p += suffix_length;
+#if PY3K
+	PyObject* out = PyUnicode_DecodeUTF8(buf, p - buf, NULL);
+#else
+	PyObject* out = PyString_FromStringAndSize(buf, p - buf);
+#endif
+	PyMem_Free(buf);
+	return out;
+}
+
+// freelist
+/* Short-lived example_class objects (e.g. the result of 'a + b') are kept on a bounded freelist
+ * instead of being returned to the allocator, similar to CPython's float freelist.
+ * The default capacity can be changed at compile time, or at runtime via template.set_freelist_size().
+ * Free-threaded builds don't use it: their allocator (mimalloc) already keeps per-thread pools of free blocks,
+ * while a shared freelist would need a lock on every allocation.
+ */
+#ifndef EXAMPLE_CLASS_FREELIST_SIZE
+#define EXAMPLE_CLASS_FREELIST_SIZE 256
+#endif
+
+static example_class* example_class_freelist_pop(template_state* state) {
+#ifdef Py_GIL_DISABLED
+	return NULL;
+#endif
+	example_class_freelist_state* freelist = &state->freelist;
+	example_class* op = freelist->head;
+	if (op == NULL) {
+		freelist->misses++;
+		return NULL;
+	}
+	freelist->head = (example_class*)((PyObject*)op)->ob_type;
+	freelist->size--;
+	freelist->hits++;
+	TEMPLATE_COUNT(STAT_FREELIST_HIT);
+	return (example_class*)PyObject_Init((PyObject*)op, state->example_class_type);
+}
+
+static bool example_class_freelist_push(template_state* state, example_class* op) {
+	// the state keeps the type alive, so free objects don't hold a reference to it
+#ifdef Py_GIL_DISABLED
+	return false;
+#endif
+	example_class_freelist_state* freelist = &state->freelist;
+	if (freelist->size >= freelist->capacity) {
+		return false;
+	}
+	((PyObject*)op)->ob_type = (PyTypeObject*)freelist->head;
+	freelist->head = op;
+	freelist->size++;
+	Py_DECREF_HEAPTYPE(state->example_class_type);
+	return true;
+}
+
+static void example_class_freelist_trim(template_state* state, Py_ssize_t capacity) {
+	example_class_freelist_state* freelist = &state->freelist;
+#ifndef Py_GIL_DISABLED
+	freelist->capacity = capacity;
+#endif
+	while (freelist->size > capacity) {
+		example_class* op = freelist->head;
+		freelist->head = (example_class*)((PyObject*)op)->ob_type;
+		freelist->size--;
+		state->example_class_type->tp_free((PyObject*)op);
+	}
+}
+
+static PyObject* pack_example_class(template_state* state, double value) {
+	example_class* out = example_class_freelist_pop(state);
+
+	if (out == NULL) {
+		TEMPLATE_COUNT(STAT_ALLOC);
+		out = (example_class*)state->example_class_type->tp_alloc(state->example_class_type, 0);
+	}
+
+	if (out != NULL) {
+		out->value = value;
+	}
+
+	return (PyObject*)out;
+}
+
+static bool unpack_example_class(template_state* state, PyObject * op, internal_example_class* out) {
+	/* Returns false if <op> is not example_class compatible.
+	 * If the conversion itself failed, an error is set as well.
+	 */
+	if (Py_TYPE(op) == state->example_class_type) {
+		TEMPLATE_COUNT(STAT_UNPACK_EXACT);
+		out->value = example_class_load((example_class*)op);
+		return true;
+	}
+	if (PyFloat_CheckExact(op)) {
+		TEMPLATE_COUNT(STAT_UNPACK_FLOAT);
+		out->value = PyFloat_AS_DOUBLE(op);
+		return true;
+	}
+	if (PyObject_TypeCheck(op, state->example_class_type)) {
+		TEMPLATE_COUNT(STAT_UNPACK_SUBCLASS);
+		out->value = example_class_load((example_class*)op);
+		return true;
+	}
+	int result = PyExtNumber_ToDouble(op, &out->value);
+	TEMPLATE_COUNT((result == 0) ? STAT_UNPACK_FAILED : PyFloat_Check(op) ? STAT_UNPACK_FLOAT : PyLong_Check(op) ? STAT_UNPACK_INT : STAT_UNPACK_DUCK);
+	return result == 1;
+}
+
+// buffer protocol
+static Py_ssize_t double_buffer_strides[1] = { sizeof(double) };
+static Py_ssize_t example_class_buffer_shape[1] = { 1 };
+
+static int fill_double_buffer(Py_buffer* view, PyObject* exporter, double* data, Py_ssize_t* shape, int flags) {
+	/* Fills <view> with a writable, one-dimensional, C-contiguous buffer of <shape[0]> doubles.
+	 * <shape> has to stay valid until the buffer is released.
+	 */
+	view->obj = exporter;
+	Py_INCREF(exporter);
+	view->buf = data;
+	view->len = shape[0] * (Py_ssize_t)sizeof(double);
+	view->readonly = 0;
+	view->itemsize = sizeof(double);
+	view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : NULL;
+	view->ndim = 1;
+	view->shape = (flags & PyBUF_ND) ? shape : NULL;
+	view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? double_buffer_strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	return 0;
+}
+
+static char buffer_native_format(const Py_buffer* view) {
+	/* Returns the struct format character of <view> if it holds native numbers
+	 * that can be converted to double, or 0 otherwise.
+	 */
+	const char* format = (view->format == NULL) ? "B" : view->format;
+	if (*format == '@') {
+		format++;
+	}
+	if (format[0] == '\0' || format[1] != '\0') {
+		return 0;
+	}
+	switch (format[0]) {
+	case 'd': return (view->itemsize == sizeof(double)) ? 'd' : 0;
+	case 'f': return (view->itemsize == sizeof(float)) ? 'f' : 0;
+	case '?': case 'b': case 'B': return (view->itemsize == 1) ? format[0] : 0;
+	case 'h': case 'H': return (view->itemsize == sizeof(short)) ? format[0] : 0;
+	case 'i': case 'I': return (view->itemsize == sizeof(int)) ? format[0] : 0;
+	case 'l': case 'L': return (view->itemsize == sizeof(long)) ? format[0] : 0;
+	case 'q': case 'Q': return (view->itemsize == sizeof(long long)) ? format[0] : 0;
+	case 'n': case 'N': return (view->itemsize == sizeof(Py_ssize_t)) ? format[0] : 0;
+	default: return 0;
+	}
+}
+
+template<typename T>
+static void convert_to_doubles(const void* src, double* out, Py_ssize_t count) {
+	const T* in = (const T*)src;
+	for (Py_ssize_t i = 0; i < count; i++) {
+		out[i] = (double)in[i];
+	}
+}
+
+static void buffer_to_doubles(const Py_buffer* view, char format, double* out) {
+	// copies all items of a C-contiguous <view> with the native <format> into <out>
+	Py_ssize_t count = view->len / view->itemsize;
+	switch (format) {
+	case 'd': memcpy(out, view->buf, (size_t)view->len); break;
+	case 'f': convert_to_doubles<float>(view->buf, out, count); break;
+	case '?': convert_to_doubles<unsigned char>(view->buf, out, count); break;
+	case 'b': convert_to_doubles<signed char>(view->buf, out, count); break;
+	case 'B': convert_to_doubles<unsigned char>(view->buf, out, count); break;
+	case 'h': convert_to_doubles<short>(view->buf, out, count); break;
+	case 'H': convert_to_doubles<unsigned short>(view->buf, out, count); break;
+	case 'i': convert_to_doubles<int>(view->buf, out, count); break;
+	case 'I': convert_to_doubles<unsigned int>(view->buf, out, count); break;
+	case 'l': convert_to_doubles<long>(view->buf, out, count); break;
+	case 'L': convert_to_doubles<unsigned long>(view->buf, out, count); break;
+	case 'q': convert_to_doubles<long long>(view->buf, out, count); break;
+	case 'Q': convert_to_doubles<unsigned long long>(view->buf, out, count); break;
+	case 'n': convert_to_doubles<Py_ssize_t>(view->buf, out, count); break;
+	case 'N': convert_to_doubles<size_t>(view->buf, out, count); break;
+	}
+}
+
+static bool get_numeric_buffer(PyObject* obj, Py_buffer* view, char* format) {
+	/* Requests a one-dimensional, C-contiguous buffer of native numbers from <obj>.
+	 * Returns false without an error set if <obj> doesn't export such a buffer,
+	 * in which case callers should fall back to the iterator protocol.
+	 */
+	if (!PyObject_CheckBuffer(obj)) {
+		return false;
+	}
+	if (PyObject_GetBuffer(obj, view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+		PyErr_Clear();
+		return false;
+	}
+	*format = buffer_native_format(view);
+	if (*format == 0 || view->ndim > 1) {
+		PyBuffer_Release(view);
+		return false;
+	}
+	return true;
+}
+
+static int
+example_class_getbuffer(example_class* self, Py_buffer* view, int flags)
+{
+	return fill_double_buffer(view, (PyObject*)self, &self->value, example_class_buffer_shape, flags);
+}
+
+static void
+example_class_dealloc(example_class* self)
+{
+	// subclass instances may be larger than example_class, so only exact instances are recycled
+	PyTypeObject* type = Py_TYPE(self);
+	template_state* state = template_state_of_type(type);
+	if (type == state->example_class_type && example_class_freelist_push(state, self)) {
+		return;
+	}
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+static PyObject *
+example_class_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	example_class *self = NULL;
+
+	template_state* state = template_state_of_type(type);
+	if (type == state->example_class_type) {
+		self = example_class_freelist_pop(state);
+	}
+	if (self == NULL) {
+		TEMPLATE_COUNT(STAT_ALLOC);
+		self = (example_class *)type->tp_alloc(type, 0);
+	}
+	if (self != NULL) {
+		self->value = 0.0;
+	}
+
+	return (PyObject *)self;
+}
+
+static int
 example_class_init(example_class *self, PyObject *args, PyObject *kwargs)
 {
-	static char *kwlist[] = { "value", NULL };
+	static char *kwlist[] = { "value", NULL };
+
+	PyObject * arg1 = NULL;
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist,
+		&arg1)) {
+		internal_example_class o;
+		if (arg1 == NULL) {
+			return 0;
+		}
+		if (unpack_example_class(template_state_of((PyObject*)self), arg1, &o)) {
+			example_class_store(self, o.value);
+			return 0;
+		}
+		if (PyErr_Occurred()) {
+			return -1;
+		}
+	}
+	else {
+		return -1;
+	}
+	PyErr_SetString(PyExc_TypeError, "invalid argument type(s) for example_class()");
+	return -1;
+}
+
+#if PY_VERSION_HEX >= 0x03090000
+static PyObject *
+example_class_vectorcall(PyObject *type, PyObject *const *args, size_t nargsf, PyObject *kwnames)
+{
+	/* PEP 590 vectorcall, used for 'example_class(...)' instead of tp_new + tp_init,
+	 * so neither an argument tuple nor a keyword dict is created.
+	 */
+	static const char *kwlist[] = { "value", NULL };
+
+	PyObject * arg1;
+	internal_example_class o;
+
+	if (!parse_arguments("example_class", kwlist, 0, args, PyVectorcall_NARGS(nargsf), kwnames, NULL, &arg1)) {
+		return NULL;
+	}
+	template_state* state = template_state_of_type((PyTypeObject*)type);
+	o.value = 0.0;
+	if (arg1 != NULL && !unpack_example_class(state, arg1, &o)) {
+		if (!PyErr_Occurred()) {
+			PyErr_SetString(PyExc_TypeError, "invalid argument type(s) for example_class()");
+		}
+		return NULL;
+	}
+	if ((PyTypeObject*)type == state->example_class_type) {
+		return pack_example_class(state, o.value);
+	}
+	example_class *self = (example_class *)example_class_new((PyTypeObject *)type, NULL, NULL);
+	if (self != NULL) {
+		self->value = o.value;
+	}
+	return (PyObject *)self;
+}
+#endif
+
+// unaryfunc
+static PyObject *
+example_class_neg(example_class *obj)
+{
+	/* Returns the negation of <obj> on success, 
+	 * or NULL on failure. This is the 
+	 * equivalent of the Python expression '-obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_NEGATIVE);
+	return pack_example_class(template_state_of((PyObject*)obj), -example_class_load(obj));
+}
+
+static PyObject *
+example_class_pos(example_class *obj)
+{
+	/* Returns <obj> on success,
+	 * or NULL on failure. This is the
+	 * equivalent of the Python expression '+obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_POSITIVE);
+	return pack_example_class(template_state_of((PyObject*)obj), example_class_load(obj));
+}
+
+static PyObject *
+example_class_abs(example_class *obj)
+{
+	/* Returns the absolute value of obj, 
+	 * or NULL on failure. This is the 
+	 * equivalent of the Python expression 'abs(obj)'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_ABSOLUTE);
+	return pack_example_class(template_state_of((PyObject*)obj), fabs(example_class_load(obj)));
+}
+
+// conversions
+/* There is no nb_index: like float, example_class holds arbitrary real values,
+ * so it can't be used as a sequence index or wherever else an exact integer is required.
+ */
+static PyObject *
+example_class_float(example_class *obj)
+{
+	// float(obj), also used by PyFloat_AsDouble(), and so by the math and struct modules
+	return PyFloat_FromDouble(example_class_load(obj));
+}
+
+static PyObject *
+example_class_int(example_class *obj)
+{
+	// int(obj), truncates towards zero and raises for infinities and NaN, like int(float)
+	return PyLong_FromDouble(example_class_load(obj));
+}
+
+static int
+example_class_bool(example_class *obj)
+{
+	// bool(obj), false only for zero
+	return example_class_load(obj) != 0.0;
+}
+
+// binaryfunc
+static PyObject *
+example_class_add(PyObject *obj1, PyObject *obj2)
+{
+	/* Returns the result of adding obj1 to obj2, 
+	 * or NULL on failure. This is the 
+	 * equivalent of the Python expression 'obj1 + obj2'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_ADD);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+	
+	if (unpack_example_class(state, obj1, &o1) && unpack_example_class(state, obj2, &o2)) {
+		return pack_example_class(state, 
+			o1.value + o2.value
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+static PyObject *
+example_class_sub(PyObject *obj1, PyObject *obj2)
+{
+	/* Returns the result of subtracting obj2 from obj1,
+	 * or NULL on failure. This is the
+	 * equivalent of the Python expression 'obj1 - obj2'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_SUBTRACT);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+
+	if (unpack_example_class(state, obj1, &o1) && unpack_example_class(state, obj2, &o2)) {
+		return pack_example_class(state, 
+			o1.value - o2.value
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+static PyObject *
+example_class_mul(PyObject *obj1, PyObject *obj2)
+{
+	/* Returns the result of multiplying obj1 and obj2,
+	 * or NULL on failure. This is the
+	 * equivalent of the Python expression 'obj1 * obj2'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_MULTIPLY);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+
+	if (unpack_example_class(state, obj1, &o1) && unpack_example_class(state, obj2, &o2)) {
+		return pack_example_class(state, 
+			o1.value * o2.value
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+static PyObject *
+example_class_truediv(PyObject *obj1, PyObject *obj2)
+{
+	/* Returns the result of dividing obj1 by obj2,
+	 * or NULL on failure. This is the
+	 * equivalent of the Python 3 expression 'obj1 / obj2',
+	 * and the Python 2 expression 'obj1.__truediv__(obj2)'.
+	 */
+	TEMPLATE_COUNT(STAT_NB_TRUE_DIVIDE);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+
+	if (unpack_example_class(state, obj1, &o1) && unpack_example_class(state, obj2, &o2)) {
+		return pack_example_class(state, 
+			o1.value / o2.value
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+static PyObject *
+example_class_mod(PyObject *obj1, PyObject *obj2)
+{
+	/* Returns the remainder of dividing obj1 by obj2,
+	 * or NULL on failure. This is the
+	 * equivalent of the Python expression 'obj1 % obj2'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_REMAINDER);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+
+	if (unpack_example_class(state, obj1, &o1) && unpack_example_class(state, obj2, &o2)) {
+		return pack_example_class(state, 
+			fmod(o1.value, o2.value)
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+static PyObject *
+example_class_floordiv(PyObject *obj1, PyObject *obj2)
+{
+	/* Returns the floor of obj1 divided by obj2,
+	 * or NULL on failure. This is the
+	 * equivalent of the Python expression 'obj1 // obj2'
+	 * and the Python 2 expression 'obj1 / obj2'.
+	 */
+	TEMPLATE_COUNT(STAT_NB_FLOOR_DIVIDE);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+
+	if (unpack_example_class(state, obj1, &o1) && unpack_example_class(state, obj2, &o2)) {
+		return pack_example_class(state, 
+			floor(o1.value / o2.value)
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+static PyObject *
+example_class_divmod(PyObject * obj1, PyObject * obj2) {
+	/* See the built-in function divmod(). 
+	 * Returns NULL on failure. This is the 
+	 * equivalent of the Python expression 'divmod(obj1, obj2)'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_DIVMOD);
+	return Py_BuildValue("(OO)", example_class_floordiv(obj1, obj2), example_class_mod(obj1, obj2));
+}
+
+// ternaryfunc
+static PyObject *
+example_class_pow(PyObject * obj1, PyObject * obj2, PyObject * obj3) {
+	/* See the built-in function pow(). 
+	 * Returns NULL on failure. This is the 
+	 * equivalent of the Python expression 'pow(obj1, obj2, obj3)', 
+	 * where obj3 is optional.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_POWER);
+	template_state* state = template_state_of_operands(obj1, obj2);
+	internal_example_class o1, o2;
+
+	if (!unpack_example_class(state, obj1, &o1) || !unpack_example_class(state, obj2, &o2)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	if (obj3 == Py_None) {
+		return pack_example_class(state, 
+			pow(o1.value, o2.value)
+		);
+	}
+
+	internal_example_class o3;
+
+	if (unpack_example_class(state, obj3, &o3)) {
+		return pack_example_class(state, 
+			fmod(pow(o1.value, o2.value), o3.value)
+		);
+	}
+
+	Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+}
+
+// inplace
+// binaryfunc
+static PyObject *
+example_class_iadd(example_class *self, PyObject *obj)
+{
+	/* Returns the result of adding obj to self, 
+	 * or NULL on failure. The operation is done in-place. 
+	 * This is the equivalent of the 
+	 * Python statement 'self += obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_ADD);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, value + o.value);
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject *
+example_class_isub(example_class *self, PyObject *obj)
+{
+	/* Returns the result of subtracting obj from self,
+	 * or NULL on failure. The operation is done in-place.
+	 * This is the equivalent of the
+	 * Python statement 'self -= obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_SUBTRACT);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, value - o.value);
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject *
+example_class_imul(example_class *self, PyObject *obj)
+{
+	/* Returns the result of multiplying self by obj,
+	 * or NULL on failure. The operation is done in-place.
+	 * This is the equivalent of the
+	 * Python statement 'self *= obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_MULTIPLY);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, value * o.value);
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject *
+example_class_itruediv(example_class *self, PyObject *obj)
+{
+	/* Returns the result of dividing self by obj,
+	 * or NULL on failure. The operation is done in-place.
+	 * This is the equivalent of the
+	 * Python 3 statement 'self /= obj'
+	 * and the Python 2 expression 'self.__itruediv__(obj).
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_TRUE_DIVIDE);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, value / o.value);
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject *
+example_class_imod(example_class *self, PyObject *obj)
+{
+	/* Returns the remainder of self divided by obj,
+	 * or NULL on failure. The operation is done in-place.
+	 * This is the equivalent of the
+	 * Python statement 'self %= obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_REMAINDER);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, fmod(value, o.value));
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject *
+example_class_ifloordiv(example_class *self, PyObject *obj)
+{
+	/* Returns the floor of self divided by obj,
+	 * or NULL on failure. The operation is done in-place.
+	 * This is the equivalent of the
+	 * Python statement 'self //= obj'.
+	 * and the Python 2 statement 'self /= obj'
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_FLOOR_DIVIDE);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, floor(value / o.value));
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+// ternaryfunc
+static PyObject *
+example_class_ipow(example_class *self, PyObject *obj1, PyObject * obj2) // obj2 is unused. It points to an invalid address!
+{
+	/* Returns the result of self to the power of obj1,
+	 * or NULL on failure. The operation is done in-place.
+	 * This is the equivalent of the
+	 * Python statement 'self **= obj'.
+	 * (quoted from https://docs.python.org/3/c-api/number.html)
+	 */
+	TEMPLATE_COUNT(STAT_NB_INPLACE_POWER);
+	template_state* state = template_state_of((PyObject*)self);
+	internal_example_class o;
+
+	if (!unpack_example_class(state, obj1, &o)) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+
+	Py_BEGIN_CRITICAL_SECTION(self);
+	double value = example_class_load(self);
+	example_class_store(self, pow(value, o.value));
+	Py_END_CRITICAL_SECTION();
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject *
+example_class_str(example_class* self)
+{
+	char str_as_cstr[48];
+	int length = snprintf(str_as_cstr, sizeof(str_as_cstr), "example_class( %12.6g )", example_class_load(self));
+#if PY3K
+	return PyUnicode_FromStringAndSize(str_as_cstr, length);
+#else
+	return PyString_FromStringAndSize(str_as_cstr, length);
+#endif
+}
+
+static PyObject *
+example_class_repr(example_class* self)
+{
+	// unlike str(), repr() round-trips: eval(repr(x)) == x
+	char str_as_cstr[sizeof("example_class()") + FORMAT_DOUBLE_MAX];
+	memcpy(str_as_cstr, "example_class(", 14);
+	int length = 14 + format_double(example_class_load(self), str_as_cstr + 14);
+	str_as_cstr[length++] = ')';
+#if PY3K
+	return PyUnicode_FromStringAndSize(str_as_cstr, length);
+#else
+	return PyString_FromStringAndSize(str_as_cstr, length);
+#endif
+}
+
+static Py_ssize_t example_class_len(example_class * self) {
+	return (Py_ssize_t)1;
+}
+
+static PyObject* example_class_sq_item(example_class * self, Py_ssize_t index) {
+	switch (index) {
+	case 0:
+		return PyFloat_FromDouble(example_class_load(self));
+	default:
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return NULL;
+	}
+}
+
+static int example_class_sq_setitem(example_class * self, Py_ssize_t index, PyObject * value) {
+	internal_example_class o;
+	if (!unpack_example_class(template_state_of((PyObject*)self), value, &o)) {
+		if (!PyErr_Occurred()) {
+			Py_RAISE_TYPEERROR_O("must be a real number, not ", value);
+		}
+		return -1;
+	}
+	switch (index) {
+	case 0:
+		example_class_store(self, o.value);
+		return 0;
+	default:
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return -1;
+	}
+}
+
+static int example_class_contains(example_class * self, PyObject * value) {
+	internal_example_class o;
+	if (unpack_example_class(template_state_of((PyObject*)self), value, &o)) {
+		return (int)(o.value == example_class_load(self));
+	}
+	return PyErr_Occurred() ? -1 : 0;
+
+}
+
+static PyObject * example_class_richcompare(example_class * self, PyObject * other, int comp_type) {
+	TEMPLATE_COUNT(STAT_RICHCOMPARE);
+	internal_example_class o2;
+
+	// example_class_i64 compares exactly, like float compared to int, unpacking it would round the integer
+	PyObject* i64_result = variant_compare_i64(example_class_load(self), other, comp_type);
+	if (i64_result != NULL || PyErr_Occurred()) {
+		return i64_result;
+	}
+	if (!unpack_example_class(template_state_of((PyObject*)self), other, &o2)) {
+		if (PyErr_Occurred()) {
+			return NULL;
+		}
+		if (comp_type == Py_EQ || comp_type == Py_NE) {
+			Py_RETURN_FALSE;
+		}
+		Py_RETURN_NOTIMPLEMENTED;
+	}
+
+	double value = example_class_load(self);
+	switch (comp_type) {
+	case Py_EQ :
+		if (value == o2.value) Py_RETURN_TRUE;
+		else Py_RETURN_FALSE;
+		break;
+	case Py_NE :
+		if (value != o2.value) Py_RETURN_TRUE;
+		else Py_RETURN_FALSE;
+		break;
+	case Py_LT :
+		if (value < o2.value) Py_RETURN_TRUE;
+		else Py_RETURN_FALSE;
+		break;
+	case Py_LE :
+		if (value <= o2.value) Py_RETURN_TRUE;
+		else Py_RETURN_FALSE;
+		break;
+	case Py_GT :
+		if (value > o2.value) Py_RETURN_TRUE;
+		else Py_RETURN_FALSE;
+		break;
+	case Py_GE :
+		if (value >= o2.value) Py_RETURN_TRUE;
+		else Py_RETURN_FALSE;
+		break;
+	default :
+		Py_RETURN_NOTIMPLEMENTED;
+	}
+}
+
+static Py_hash_t example_class_hash(example_class * self) {
+	/* Hashes the value the same way float does, so that hash(example_class(x)) == hash(x).
+	 * Note that the in-place operators mutate the value, so don't mutate instances that are used as keys.
+	 */
+#if PY_VERSION_HEX >= 0x030A0000
+	return _Py_HashDouble((PyObject*)self, example_class_load(self));
+#else
+	return _Py_HashDouble(example_class_load(self));
+#endif
+}
+
+#ifdef Py_GIL_DISABLED
+static PyObject * example_class_get_value(example_class * self, void * closure) {
+	return PyFloat_FromDouble(example_class_load(self));
+}
+
+static int example_class_set_value(example_class * self, PyObject * value, void * closure) {
+	// called with the critical section held, like the in-place operators
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "can't delete numeric/char attribute");
+		return -1;
+	}
+	double v = PyFloat_AsDouble(value);
+	if (v == -1.0 && PyErr_Occurred()) {
+		return -1;
+	}
+	example_class_store(self, v);
+	return 0;
+}
+#endif
+
+static PyObject * example_class_get_secret(example_class * self, void * closure) {
+	PyObject* pi = template_state_of((PyObject*)self)->pi;
+	Py_INCREF(pi);
+	return pi;
+}
+
+// iterator
+
+static PyObject *
+example_classIter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	example_class *sequence;
+
+	if (!PyArg_UnpackTuple(args, "__iter__", 1, 1, &sequence))
+		return NULL;
+
+	/* Create a new example_classIter and initialize its state - pointing to the last
+	* index in the sequence.
+	*/
+	example_classIter *rgstate = (example_classIter *)type->tp_alloc(type, 0);
+	if (!rgstate)
+		return NULL;
+
+	rgstate->sequence = sequence;
+	Py_INCREF(sequence);
+	rgstate->seq_index = 0;
+
+	return (PyObject *)rgstate;
+}
+
+static void
+example_classIter_dealloc(example_classIter *rgstate)
+{
+	PyTypeObject* type = Py_TYPE(rgstate);
+	Py_XDECREF(rgstate->sequence);
+	type->tp_free(rgstate);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+static PyObject *
+example_classIter_next(example_classIter *rgstate)
+{
+	if (rgstate->seq_index < 1) {
+		if (rgstate->seq_index == 0) {
+			rgstate->seq_index++;
+			return PyFloat_FromDouble(example_class_load(rgstate->sequence));
+		}
+	}
+	rgstate->seq_index = 1;
+	Py_CLEAR(rgstate->sequence);
+	return NULL;
+}
+
+static PyObject *
+example_classIter_length_hint(example_classIter *rgstate, PyObject* unused)
+{
+	// the number of values left, so list(it) and friends can presize
+	return PyLong_FromSsize_t((rgstate->sequence != NULL && rgstate->seq_index < 1) ? 1 - rgstate->seq_index : 0);
+}
+
+static PyObject * example_class_geniter(example_class * self) {
+	TEMPLATE_COUNT(STAT_ITER_CREATED);
+	PyTypeObject* type = template_state_of((PyObject*)self)->example_classIter_type;
+	example_classIter *rgstate = (example_classIter *)type->tp_alloc(type, 0);
+	if (!rgstate)
+		return NULL;
+
+	rgstate->sequence = self;
+	Py_INCREF(self);
+	rgstate->seq_index = 0;
+
+	return (PyObject *)rgstate;
+}
+
+// value variants
+/* example_class_f32 and example_class_i64 hold a float or a 64-bit integer instead of a double, for data that
+ * tolerates single precision in half the memory, and for exact integer arithmetic. Both are instantiations of
+ * example_class_variant<T>, the slots are generated from the value type. Unlike example_class they are immutable
+ * (like float and int), so they have no in-place operators and are safe to share between threads.
+ * Binary operations promote their operands:
+ *   variant<T> op variant<T>, a Python int or (for f32) a Python float  -> variant<T>
+ *   f32 op i64, or either op example_class or any other real number     -> example_class
+ * f32 arithmetic rounds like C float arithmetic. i64 arithmetic is exact and follows the semantics of int
+ * (floor division, a remainder with the sign of the divisor, ZeroDivisionError), raising OverflowError for results
+ * that don't fit. '/' and negative powers of i64 values give an example_class, like int / int gives a float.
+ */
+template<typename T>
+struct example_class_variant {
+	PyObject_HEAD
+		T value;
+};
+
+typedef example_class_variant<float> example_class_f32;
+typedef example_class_variant<int64_t> example_class_i64;
+
+template<typename T> struct variant_traits;
+
+template<> struct variant_traits<float> {
+	static constexpr const char* name = "example_class_f32";
+	static constexpr const char* qualified_name = "template.example_class_f32";
+	static constexpr PyTypeObject* template_state::* type = &template_state::example_class_f32_type;
+	static constexpr int member_type = T_FLOAT;
+	static constexpr bool exact = false;
+};
+
+template<> struct variant_traits<int64_t> {
+	static constexpr const char* name = "example_class_i64";
+	static constexpr const char* qualified_name = "template.example_class_i64";
+	static constexpr PyTypeObject* template_state::* type = &template_state::example_class_i64_type;
+	static constexpr int member_type = T_LONGLONG;
+	static constexpr bool exact = true;
+};
+
+static PyObject* variant_overflow() {
+	PyErr_SetString(PyExc_OverflowError, "integer overflow in example_class_i64 arithmetic");
+	return NULL;
+}
+
+static PyObject* variant_zero_division() {
+	PyErr_SetString(PyExc_ZeroDivisionError, "integer division or modulo by zero");
+	return NULL;
+}
+
+static inline bool int64_add_overflow(int64_t a, int64_t b, int64_t* out) {
+#if defined(__GNUC__)
+	return __builtin_add_overflow(a, b, out);
+#else
+	if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
+		return true;
+	}
+	*out = a + b;
+	return false;
+#endif
+}
+
+static inline bool int64_sub_overflow(int64_t a, int64_t b, int64_t* out) {
+#if defined(__GNUC__)
+	return __builtin_sub_overflow(a, b, out);
+#else
+	if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
+		return true;
+	}
+	*out = a - b;
+	return false;
+#endif
+}
+
+static inline bool int64_mul_overflow(int64_t a, int64_t b, int64_t* out) {
+#if defined(__GNUC__)
+	return __builtin_mul_overflow(a, b, out);
+#else
+	if (a != 0 && b != 0) {
+		if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) {
+			return true;
+		}
+		if (a != -1 && b != -1 && ((a > 0) == (b > 0) ? (a > 0 ? a > INT64_MAX / b : a < INT64_MAX / b) : (a > 0 ? b < INT64_MIN / a : a < INT64_MIN / b))) {
+			return true;
+		}
+	}
+	*out = a * b;
+	return false;
+#endif
+}
+
+// largest magnitude up to which every int64_t is exactly representable as a double
+#define VARIANT_EXACT_DOUBLE ((int64_t)1 << 53)
+
+template<typename T>
+static PyObject* variant_pack(template_state* state, T value) {
+	PyTypeObject* type = state->*variant_traits<T>::type;
+	example_class_variant<T>* out = (example_class_variant<T>*)type->tp_alloc(type, 0);
+	if (out != NULL) {
+		out->value = value;
+	}
+	return (PyObject*)out;
+}
+
+enum variant_operand { VARIANT_NONE, VARIANT_SAME, VARIANT_REAL, VARIANT_ERROR };
+
+template<typename T>
+static variant_operand variant_unpack(template_state* state, PyObject* op, T* value, double* real);
+
+template<>
+variant_operand variant_unpack<float>(template_state* state, PyObject* op, float* value, double* real) {
+	/* VARIANT_SAME: <op> is an f32 or a Python float / int, stored in <value>.
+	 * VARIANT_REAL: any other real number, stored in <real>.
+	 */
+	if (PyObject_TypeCheck(op, state->example_class_f32_type)) {
+		*value = ((example_class_f32*)op)->value;
+		return VARIANT_SAME;
+	}
+	if (PyFloat_Check(op)) {
+		*value = (float)PyFloat_AS_DOUBLE(op);
+		return VARIANT_SAME;
+	}
+	if (PyLong_Check(op)) {
+		double x = PyLong_AsDouble(op);
+		if (x == -1.0 && PyErr_Occurred()) {
+			return VARIANT_ERROR;
+		}
+		*value = (float)x;
+		return VARIANT_SAME;
+	}
+#if !PY3K
+	if (PyInt_Check(op)) {
+		*value = (float)PyInt_AS_LONG(op);
+		return VARIANT_SAME;
+	}
+#endif
+	int result = PyExtNumber_ToDouble(op, real);
+	return (result == 1) ? VARIANT_REAL : (result == 0) ? VARIANT_NONE : VARIANT_ERROR;
+}
+
+template<>
+variant_operand variant_unpack<int64_t>(template_state* state, PyObject* op, int64_t* value, double* real) {
+	/* VARIANT_SAME: <op> is an i64 or a Python int, stored in <value>.
+	 * VARIANT_REAL: any other real number, stored in <real>.
+	 */
+	if (PyObject_TypeCheck(op, state->example_class_i64_type)) {
+		*value = ((example_class_i64*)op)->value;
+		return VARIANT_SAME;
+	}
+	if (PyLong_Check(op)) {
+		int overflow;
+		long long x = PyLong_AsLongLongAndOverflow(op, &overflow);
+		if (overflow != 0) {
+			PyErr_SetString(PyExc_OverflowError, "Python int too large for example_class_i64");
+			return VARIANT_ERROR;
+		}
+		if (x == -1 && PyErr_Occurred()) {
+			return VARIANT_ERROR;
+		}
+		*value = (int64_t)x;
+		return VARIANT_SAME;
+	}
+#if !PY3K
+	if (PyInt_Check(op)) {
+		*value = (int64_t)PyInt_AS_LONG(op);
+		return VARIANT_SAME;
+	}
+#endif
+	int result = PyExtNumber_ToDouble(op, real);
+	return (result == 1) ? VARIANT_REAL : (result == 0) ? VARIANT_NONE : VARIANT_ERROR;
+}
+
+/* The binary operations, each with the arithmetic of both value types
+ * and the double arithmetic of example_class that promoted operands use.
+ */
+struct variant_add {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, a + b); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		int64_t out;
+		return int64_add_overflow(a, b, &out) ? variant_overflow() : variant_pack(state, out);
+	}
+	static double real(double a, double b) { return a + b; }
+};
+
+struct variant_sub {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, a - b); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		int64_t out;
+		return int64_sub_overflow(a, b, &out) ? variant_overflow() : variant_pack(state, out);
+	}
+	static double real(double a, double b) { return a - b; }
+};
+
+struct variant_mul {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, a * b); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		int64_t out;
+		return int64_mul_overflow(a, b, &out) ? variant_overflow() : variant_pack(state, out);
+	}
+	static double real(double a, double b) { return a * b; }
+};
+
+struct variant_truediv {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, a / b); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		if (b == 0) {
+			PyErr_SetString(PyExc_ZeroDivisionError, "division by zero");
+			return NULL;
+		}
+		if (a > -VARIANT_EXACT_DOUBLE && a < VARIANT_EXACT_DOUBLE && b > -VARIANT_EXACT_DOUBLE && b < VARIANT_EXACT_DOUBLE) {
+			return pack_example_class(state, (double)a / (double)b);
+		}
+		// int / int rounds the exact quotient once, (double)a / (double)b could round twice
+		PyObject* x = PyLong_FromLongLong(a);
+		PyObject* y = PyLong_FromLongLong(b);
+		PyObject* quotient = (x != NULL && y != NULL) ? PyNumber_TrueDivide(x, y) : NULL;
+		Py_XDECREF(x);
+		Py_XDECREF(y);
+		if (quotient == NULL) {
+			return NULL;
+		}
+		PyObject* out = pack_example_class(state, PyFloat_AS_DOUBLE(quotient));
+		Py_DECREF(quotient);
+		return out;
+	}
+	static double real(double a, double b) { return a / b; }
+};
+
+struct variant_floordiv {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, floorf(a / b)); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		if (b == 0) {
+			return variant_zero_division();
+		}
+		if (b == -1) {
+			return (a == INT64_MIN) ? variant_overflow() : variant_pack(state, -a);
+		}
+		int64_t quotient = a / b;
+		if (a % b != 0 && ((a < 0) != (b < 0))) {
+			quotient--;
+		}
+		return variant_pack(state, quotient);
+	}
+	static double real(double a, double b) { return floor(a / b); }
+};
+
+struct variant_mod {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, fmodf(a, b)); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		if (b == 0) {
+			return variant_zero_division();
+		}
+		if (b == -1) {
+			return variant_pack(state, (int64_t)0);
+		}
+		int64_t remainder = a % b;
+		if (remainder != 0 && ((remainder < 0) != (b < 0))) {
+			remainder += b;
+		}
+		return variant_pack(state, remainder);
+	}
+	static double real(double a, double b) { return fmod(a, b); }
+};
+
+struct variant_pow {
+	static PyObject* apply(template_state* state, float a, float b) { return variant_pack(state, powf(a, b)); }
+	static PyObject* apply(template_state* state, int64_t a, int64_t b) {
+		if (b < 0) {
+			if (a == 0) {
+				PyErr_SetString(PyExc_ZeroDivisionError, "0 cannot be raised to a negative power");
+				return NULL;
+			}
+			return pack_example_class(state, pow((double)a, (double)b));
+		}
+		int64_t out = 1;
+		while (b != 0) {
+			if ((b & 1) && int64_mul_overflow(out, a, &out)) {
+				return variant_overflow();
+			}
+			b >>= 1;
+			if (b != 0 && int64_mul_overflow(a, a, &a)) {
+				return variant_overflow();
+			}
+		}
+		return variant_pack(state, out);
+	}
+	static double real(double a, double b) { return pow(a, b); }
+};
+
+template<typename T, typename Op>
+static PyObject* variant_binary(PyObject* obj1, PyObject* obj2) {
+	template_state* state = template_state_of_operands(obj1, obj2);
+	T a, b;
+	double x, y;
+	variant_operand k1 = variant_unpack<T>(state, obj1, &a, &x);
+	if (k1 == VARIANT_NONE || k1 == VARIANT_ERROR) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+	variant_operand k2 = variant_unpack<T>(state, obj2, &b, &y);
+	if (k2 == VARIANT_NONE || k2 == VARIANT_ERROR) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+	if (k1 == VARIANT_SAME && k2 == VARIANT_SAME) {
+		return Op::apply(state, a, b);
+	}
+	return pack_example_class(state, Op::real((k1 == VARIANT_SAME) ? (double)a : x, (k2 == VARIANT_SAME) ? (double)b : y));
+}
+
+template<typename T>
+static PyObject* variant_divmod(PyObject* obj1, PyObject* obj2) {
+	PyObject* quotient = variant_binary<T, variant_floordiv>(obj1, obj2);
+	if (Py_IS_NOTIMPLEMENTED(quotient)) {
+		return quotient;
+	}
+	PyObject* remainder = variant_binary<T, variant_mod>(obj1, obj2);
+	if (remainder == NULL) {
+		Py_DECREF(quotient);
+		return NULL;
+	}
+	return Py_BuildValue("(NN)", quotient, remainder);
+}
+
+static PyObject* variant_pow3(template_state* state, float a, float b, float c) {
+	return variant_pack(state, fmodf(powf(a, b), c));
+}
+
+static PyObject* variant_pow3(template_state* state, int64_t a, int64_t b, int64_t c) {
+	// exact modular exponentiation is left to int
+	PyObject* x = PyLong_FromLongLong(a);
+	PyObject* y = PyLong_FromLongLong(b);
+	PyObject* z = PyLong_FromLongLong(c);
+	PyObject* power = (x != NULL && y != NULL && z != NULL) ? PyNumber_Power(x, y, z) : NULL;
+	Py_XDECREF(x);
+	Py_XDECREF(y);
+	Py_XDECREF(z);
+	if (power == NULL) {
+		return NULL;
+	}
+	long long out = PyLong_AsLongLong(power);
+	Py_DECREF(power);
+	if (out == -1 && PyErr_Occurred()) {
+		return NULL;
+	}
+	return variant_pack(state, (int64_t)out);
+}
+
+template<typename T>
+static PyObject* variant_power(PyObject* obj1, PyObject* obj2, PyObject* obj3) {
+	if (obj3 == Py_None) {
+		return variant_binary<T, variant_pow>(obj1, obj2);
+	}
+	template_state* state = template_state_of_operands(obj1, obj2);
+	T a, b, c;
+	double x, y, z;
+	variant_operand k1 = variant_unpack<T>(state, obj1, &a, &x);
+	variant_operand k2 = (k1 == VARIANT_SAME || k1 == VARIANT_REAL) ? variant_unpack<T>(state, obj2, &b, &y) : VARIANT_NONE;
+	variant_operand k3 = (k2 == VARIANT_SAME || k2 == VARIANT_REAL) ? variant_unpack<T>(state, obj3, &c, &z) : VARIANT_NONE;
+	if (k3 == VARIANT_NONE || k3 == VARIANT_ERROR) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+	if (k1 == VARIANT_SAME && k2 == VARIANT_SAME && k3 == VARIANT_SAME) {
+		return variant_pow3(state, a, b, c);
+	}
+	return pack_example_class(state, fmod(pow((k1 == VARIANT_SAME) ? (double)a : x, (k2 == VARIANT_SAME) ? (double)b : y), (k3 == VARIANT_SAME) ? (double)c : z));
+}
+
+template<typename T> static PyObject* variant_add_slot(PyObject* obj1, PyObject* obj2) { return variant_binary<T, variant_add>(obj1, obj2); }
+template<typename T> static PyObject* variant_sub_slot(PyObject* obj1, PyObject* obj2) { return variant_binary<T, variant_sub>(obj1, obj2); }
+template<typename T> static PyObject* variant_mul_slot(PyObject* obj1, PyObject* obj2) { return variant_binary<T, variant_mul>(obj1, obj2); }
+template<typename T> static PyObject* variant_truediv_slot(PyObject* obj1, PyObject* obj2) { return variant_binary<T, variant_truediv>(obj1, obj2); }
+template<typename T> static PyObject* variant_floordiv_slot(PyObject* obj1, PyObject* obj2) { return variant_binary<T, variant_floordiv>(obj1, obj2); }
+template<typename T> static PyObject* variant_mod_slot(PyObject* obj1, PyObject* obj2) { return variant_binary<T, variant_mod>(obj1, obj2); }
+
+// unaryfunc
+static PyObject* variant_negate(template_state* state, float a) { return variant_pack(state, -a); }
+static PyObject* variant_negate(template_state* state, int64_t a) { return (a == INT64_MIN) ? variant_overflow() : variant_pack(state, -a); }
+static PyObject* variant_absolute(template_state* state, float a) { return variant_pack(state, fabsf(a)); }
+static PyObject* variant_absolute(template_state* state, int64_t a) { return (a < 0) ? variant_negate(state, a) : variant_pack(state, a); }
+
+template<typename T>
+static PyObject* variant_neg(example_class_variant<T>* self) {
+	return variant_negate(template_state_of((PyObject*)self), self->value);
+}
+
+template<typename T>
+static PyObject* variant_pos(example_class_variant<T>* self) {
+	return variant_pack(template_state_of((PyObject*)self), self->value);
+}
+
+template<typename T>
+static PyObject* variant_abs(example_class_variant<T>* self) {
+	return variant_absolute(template_state_of((PyObject*)self), self->value);
+}
+
+// conversions
+template<typename T>
+static PyObject* variant_float(example_class_variant<T>* self) {
+	return PyFloat_FromDouble((double)self->value);
+}
+
+static PyObject* variant_to_int(float value) { return PyLong_FromDouble((double)value); }
+static PyObject* variant_to_int(int64_t value) { return PyLong_FromLongLong(value); }
+
+template<typename T>
+static PyObject* variant_int(example_class_variant<T>* self) {
+	return variant_to_int(self->value);
+}
+
+template<typename T>
+static int variant_bool(example_class_variant<T>* self) {
+	return self->value != 0;
+}
+
+template<typename T>
+static PyObject* variant_index(example_class_variant<T>* self) {
+	// only for i64, whose values are exact integers
+	return variant_to_int(self->value);
+}
+
+static bool variant_to_double(PyObject* op, double* out) {
+	// reads f32 and i64 values directly, see PyExtNumber_ToDouble()
+	PyNumberMethods* number = Py_TYPE(op)->tp_as_number;
+	unaryfunc nb_float = (number != NULL) ? number->nb_float : NULL;
+	if (nb_float == (unaryfunc)variant_float<float>) {
+		*out = (double)((example_class_f32*)op)->value;
+		return true;
+	}
+	if (nb_float == (unaryfunc)variant_float<int64_t>) {
+		*out = (double)((example_class_i64*)op)->value;
+		return true;
+	}
+	return false;
+}
+
+// sequence protocol, a single value like example_class
+template<typename T>
+static Py_ssize_t variant_len(example_class_variant<T>* self) {
+	return (Py_ssize_t)1;
+}
+
+template<typename T>
+static PyObject* variant_sq_item(example_class_variant<T>* self, Py_ssize_t index) {
+	if (index != 0) {
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return NULL;
+	}
+	return variant_traits<T>::exact ? variant_to_int(self->value) : variant_float(self);
+}
+
+template<typename T>
+static int variant_contains(example_class_variant<T>* self, PyObject* value) {
+	PyObject* result = PyObject_RichCompare((PyObject*)self, value, Py_EQ);
+	if (result == NULL) {
+		return -1;
+	}
+	int out = PyObject_IsTrue(result);
+	Py_DECREF(result);
+	return out;
+}
+
+static bool variant_compare(double a, double b, int comp_type) {
+	switch (comp_type) {
+	case Py_EQ: return a == b;
+	case Py_NE: return a != b;
+	case Py_LT: return a < b;
+	case Py_LE: return a <= b;
+	case Py_GT: return a > b;
+	default: return a >= b;
+	}
+}
+
+static bool variant_compare(int64_t a, int64_t b, int comp_type) {
+	switch (comp_type) {
+	case Py_EQ: return a == b;
+	case Py_NE: return a != b;
+	case Py_LT: return a < b;
+	case Py_LE: return a <= b;
+	case Py_GT: return a > b;
+	default: return a >= b;
+	}
+}
+
+static PyObject* variant_compare_real(float a, double b, int comp_type) {
+	return PyBool_FromLong(variant_compare((double)a, b, comp_type));
+}
+
+static PyObject* variant_compare_real(int64_t a, double b, int comp_type) {
+	// exact, like int compared to float
+	if (a > -VARIANT_EXACT_DOUBLE && a < VARIANT_EXACT_DOUBLE) {
+		return PyBool_FromLong(variant_compare((double)a, b, comp_type));
+	}
+	PyObject* x = PyLong_FromLongLong(a);
+	PyObject* y = PyFloat_FromDouble(b);
+	PyObject* out = (x != NULL && y != NULL) ? PyObject_RichCompare(x, y, comp_type) : NULL;
+	Py_XDECREF(x);
+	Py_XDECREF(y);
+	return out;
+}
+
+static PyObject* variant_compare_i64(double value, PyObject* op, int comp_type) {
+	// <value> <comp_type> <op> for example_class and example_class_f32, NULL without an exception if op isn't an example_class_i64
+	PyNumberMethods* number = Py_TYPE(op)->tp_as_number;
+	if (number == NULL || number->nb_float != (unaryfunc)variant_float<int64_t>) {
+		return NULL;
+	}
+	static const int swapped[] = { Py_GT, Py_GE, Py_EQ, Py_NE, Py_LT, Py_LE }; // indexed by Py_LT ... Py_GE
+	return variant_compare_real(((example_class_i64*)op)->value, value, swapped[comp_type]);
+}
+
+template<typename T>
+static PyObject* variant_richcompare(example_class_variant<T>* self, PyObject* other, int comp_type) {
+	/* Comparisons are exact, without promotion rules: example_class_f32(0.1) != 0.1, since the float closest to 0.1 isn't 0.1.
+	 * This keeps them consistent with hash().
+	 */
+	template_state* state = template_state_of((PyObject*)self);
+	if (PyObject_TypeCheck(other, state->*variant_traits<T>::type)) {
+		return PyBool_FromLong(variant_compare(self->value, ((example_class_variant<T>*)other)->value, comp_type));
+	}
+	if (PyLong_Check(other)) {
+		// ints of any size compare exactly, as they do with int and float
+		PyObject* x = variant_traits<T>::exact ? variant_to_int(self->value) : variant_float(self);
+		PyObject* out = (x != NULL) ? PyObject_RichCompare(x, other, comp_type) : NULL;
+		Py_XDECREF(x);
+		return out;
+	}
+	if (!variant_traits<T>::exact) {
+		// f32 with i64, exactly and reflected, PyExtNumber_ToDouble() would round the integer
+		PyObject* i64_result = variant_compare_i64((double)self->value, other, comp_type);
+		if (i64_result != NULL || PyErr_Occurred()) {
+			return i64_result;
+		}
+	}
+	double real;
+	switch (PyExtNumber_ToDouble(other, &real)) {
+	case 1:
+		return variant_compare_real(self->value, real, comp_type);
+	case 0:
+		Py_RETURN_NOTIMPLEMENTED;
+	default:
+		return NULL;
+	}
+}
+
+template<typename T>
+static Py_hash_t variant_hash(example_class_variant<T>* self) {
+	// hashes like the equal float or int
+	PyObject* value = variant_traits<T>::exact ? variant_to_int(self->value) : variant_float(self);
+	if (value == NULL) {
+		return -1;
+	}
+	Py_hash_t out = PyObject_Hash(value);
+	Py_DECREF(value);
+	return out;
+}
+
+template<typename T>
+static PyObject* variant_repr(example_class_variant<T>* self) {
+	// round-trips like example_class: eval(repr(x)) == x
+	char str_as_cstr[sizeof("example_class_xxx()") + FORMAT_DOUBLE_MAX];
+	int length = snprintf(str_as_cstr, sizeof(str_as_cstr), "%s(", variant_traits<T>::name);
+	if (variant_traits<T>::exact) {
+		length += snprintf(str_as_cstr + length, sizeof(str_as_cstr) - length, "%lld", (long long)self->value);
+	}
+	else {
+		length += format_double((double)self->value, str_as_cstr + length, true);
+	}
+	str_as_cstr[length++] = ')';
+#if PY3K
+	return PyUnicode_FromStringAndSize(str_as_cstr, length);
+#else
+	return PyString_FromStringAndSize(str_as_cstr, length);
+#endif
+}
+
+static PyObject* variant_reduce_value(float value) { return PyFloat_FromDouble((double)value); }
+static PyObject* variant_reduce_value(int64_t value) { return PyLong_FromLongLong(value); }
+
+template<typename T>
+static PyObject* variant_reduce(example_class_variant<T>* self, PyObject* unused) {
+	return Py_BuildValue("(O(N))", (PyObject*)Py_TYPE(self), variant_reduce_value(self->value));
+}
+
+static bool variant_convert(template_state* state, PyObject* arg, float* out) {
+	double value;
+	int result = PyExtNumber_ToDouble(arg, &value);
+	if (result != 1) {
+		if (result == 0) {
+			PyErr_SetString(PyExc_TypeError, "invalid argument type(s) for example_class_f32()");
+		}
+		return false;
+	}
+	*out = (float)value;
+	return true;
+}
+
+static bool variant_convert(template_state* state, PyObject* arg, int64_t* out) {
+	// integers are taken exactly, other real numbers are truncated towards zero like int() does
+	double real;
+	switch (variant_unpack<int64_t>(state, arg, out, &real)) {
+	case VARIANT_SAME:
+		return true;
+	case VARIANT_ERROR:
+		return false;
+	case VARIANT_REAL:
+		if (real != real) {
+			PyErr_SetString(PyExc_ValueError, "cannot convert NaN to example_class_i64");
+			return false;
+		}
+		if (!(real >= -9223372036854775808.0 && real < 9223372036854775808.0)) {
+			PyErr_SetString(PyExc_OverflowError, "value out of range for example_class_i64");
+			return false;
+		}
+		*out = (int64_t)real;
+		return true;
+	default:
+		break;
+	}
+	if (PyIndex_Check(arg)) {
+		PyObject* index = PyNumber_Index(arg);
+		if (index == NULL) {
+			return false;
+		}
+		bool ok = variant_unpack<int64_t>(state, index, out, &real) == VARIANT_SAME;
+		Py_DECREF(index);
+		return ok;
+	}
+	PyErr_SetString(PyExc_TypeError, "invalid argument type(s) for example_class_i64()");
+	return false;
+}
+
+template<typename T>
+static PyObject* variant_new(PyTypeObject* type, PyObject* args, PyObject* kwargs) {
+	static char* kwlist[] = { (char*)"value", NULL };
+	PyObject* arg = NULL;
+	T value = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &arg)) {
+		return NULL;
+	}
+	if (arg != NULL && !variant_convert(template_state_of_type(type), arg, &value)) {
+		return NULL;
+	}
+	example_class_variant<T>* self = (example_class_variant<T>*)type->tp_alloc(type, 0);
+	if (self != NULL) {
+		self->value = value;
+	}
+	return (PyObject*)self;
+}
+
+template<typename T>
+static void variant_dealloc(example_class_variant<T>* self) {
+	PyTypeObject* type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+template<typename T>
+struct variant_type {
+	static PyMemberDef members[];
+	static PyMethodDef methods[];
+	static const char doc[];
+#if TEMPLATE_HEAP_TYPES
+	static PyType_Slot slots[];
+	static PyType_Spec spec;
+#else
+	static PySequenceMethods sequence_methods;
+	static PyNumberMethods number_methods;
+	static PyTypeObject type;
+#endif
+};
+
+template<typename T>
+PyMemberDef variant_type<T>::members[] = {
+	{ (char*)"value", variant_traits<T>::member_type, offsetof(example_class_variant<T>, value), READONLY, (char*)"value of the variant" },
+	{ NULL }  /* Sentinel */
+};
+
+template<typename T>
+PyMethodDef variant_type<T>::methods[] = {
+	{ "__reduce__", (PyCFunction)variant_reduce<T>, METH_NOARGS, "Return state information for pickling." },
+	{ NULL, NULL, 0, NULL }
+};
+
+template<>
+const char variant_type<float>::doc[] = "example_class_f32( <example_class compatible type> )\nAn immutable example_class holding a single precision float value.";
+
+template<>
+const char variant_type<int64_t>::doc[] = "example_class_i64( <integer or example_class compatible type> )\nAn immutable example_class holding a 64-bit integer value, with exact integer arithmetic.";
+
+#if TEMPLATE_HEAP_TYPES
+template<typename T>
+PyType_Slot variant_type<T>::slots[] = {
+	{ Py_tp_dealloc, (void*)variant_dealloc<T> },
+	{ Py_tp_repr, (void*)variant_repr<T> },
+	{ Py_tp_hash, (void*)variant_hash<T> },
+	{ Py_tp_doc, (void*)variant_type<T>::doc },
+	{ Py_tp_richcompare, (void*)variant_richcompare<T> },
+	{ Py_tp_methods, variant_type<T>::methods },
+	{ Py_tp_members, variant_type<T>::members },
+	{ Py_tp_new, (void*)variant_new<T> },
+	{ Py_nb_add, (void*)variant_add_slot<T> },
+	{ Py_nb_subtract, (void*)variant_sub_slot<T> },
+	{ Py_nb_multiply, (void*)variant_mul_slot<T> },
+	{ Py_nb_remainder, (void*)variant_mod_slot<T> },
+	{ Py_nb_divmod, (void*)variant_divmod<T> },
+	{ Py_nb_power, (void*)variant_power<T> },
+	{ Py_nb_negative, (void*)variant_neg<T> },
+	{ Py_nb_positive, (void*)variant_pos<T> },
+	{ Py_nb_absolute, (void*)variant_abs<T> },
+	{ Py_nb_bool, (void*)variant_bool<T> },
+	{ Py_nb_int, (void*)variant_int<T> },
+	{ Py_nb_float, (void*)variant_float<T> },
+	{ Py_nb_floor_divide, (void*)variant_floordiv_slot<T> },
+	{ Py_nb_true_divide, (void*)variant_truediv_slot<T> },
+	{ Py_sq_length, (void*)variant_len<T> },
+	{ Py_sq_item, (void*)variant_sq_item<T> },
+	{ Py_sq_contains, (void*)variant_contains<T> },
+	variant_traits<T>::exact ? PyType_Slot{ Py_nb_index, (void*)variant_index<T> } : PyType_Slot{ 0, NULL },
+	{ 0, NULL }
+};
+
+template<typename T>
+PyType_Spec variant_type<T>::spec = {
+	variant_traits<T>::qualified_name, // name
+	sizeof(example_class_variant<T>), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_IMMUTABLETYPE_COMPAT, // flags
+	variant_type<T>::slots, // slots
+};
+
+#else
+template<typename T>
+PySequenceMethods variant_type<T>::sequence_methods = {
+	(lenfunc)variant_len<T>, // sq_length
+	0, // sq_concat
+	0, // sq_repeat
+	(ssizeargfunc)variant_sq_item<T>, // sq_item
+	0,
+	0, // sq_ass_item
+	0,
+	(objobjproc)variant_contains<T>, // sq_contains
+	0, // sq_inplace_concat
+	0, // sq_inplace_repeat
+};
+
+#if PY3K
+template<typename T>
+PyNumberMethods variant_type<T>::number_methods = {
+	(binaryfunc)variant_add_slot<T>,
+	(binaryfunc)variant_sub_slot<T>,
+	(binaryfunc)variant_mul_slot<T>,
+	(binaryfunc)variant_mod_slot<T>, //nb_remainder
+	(binaryfunc)variant_divmod<T>, //nb_divmod
+	(ternaryfunc)variant_power<T>, //nb_power
+	(unaryfunc)variant_neg<T>, //nb_negative
+	(unaryfunc)variant_pos<T>, //nb_positive
+	(unaryfunc)variant_abs<T>, //nb_absolute
+	(inquiry)variant_bool<T>, //nb_bool
+	0, //nb_invert
+	0, //nb_lshift
+	0, //nb_rshift
+	0, //nb_and
+	0, //nb_xor
+	0, //nb_or
+	(unaryfunc)variant_int<T>, //nb_int
+	0, //nb_reserved
+	(unaryfunc)variant_float<T>, //nb_float
+
+	0, //nb_inplace_add
+	0, //nb_inplace_subtract
+	0, //nb_inplace_multiply
+	0, //nb_inplace_remainder
+	0, //nb_inplace_power
+	0, //nb_inplace_lshift
+	0, //nb_inplace_rshift
+	0, //nb_inplace_and
+	0, //nb_inplace_xor
+	0, //nb_inplace_or
+
+	(binaryfunc)variant_floordiv_slot<T>, //nb_floor_divide
+	(binaryfunc)variant_truediv_slot<T>,
+	0, //nb_inplace_floor_divide
+	0, //nb_inplace_true_divide
+
+	variant_traits<T>::exact ? (unaryfunc)variant_index<T> : 0, //nb_index
+};
+#else
+template<typename T>
+PyNumberMethods variant_type<T>::number_methods = {
+	(binaryfunc)variant_add_slot<T>, //nb_add;
+	(binaryfunc)variant_sub_slot<T>, //nb_subtract;
+	(binaryfunc)variant_mul_slot<T>, //nb_multiply;
+	(binaryfunc)variant_truediv_slot<T>, //nb_divide;
+	(binaryfunc)variant_mod_slot<T>, //nb_remainder;
+	(binaryfunc)variant_divmod<T>, //nb_divmod;
+	(ternaryfunc)variant_power<T>, //nb_power;
+	(unaryfunc)variant_neg<T>, //nb_negative;
+	(unaryfunc)variant_pos<T>, //nb_positive;
+	(unaryfunc)variant_abs<T>, //nb_absolute;
+	(inquiry)variant_bool<T>, //nb_nonzero;
+	0, //nb_invert;
+	0, //nb_lshift;
+	0, //nb_rshift;
+	0, //nb_and;
+	0, //nb_xor;
+	0, //nb_or;
+	0, //nb_coerce;
+	(unaryfunc)variant_int<T>, //nb_int;
+	(unaryfunc)variant_int<T>, //nb_long;
+	(unaryfunc)variant_float<T>, //nb_float;
+	0, //nb_oct;
+	0, //nb_hex;
+
+	0, //nb_inplace_add;
+	0, //nb_inplace_subtract;
+	0, //nb_inplace_multiply;
+	0, //nb_inplace_divide;
+	0, //nb_inplace_remainder;
+	0, //nb_inplace_power;
+	0, //nb_inplace_lshift;
+	0, //nb_inplace_rshift;
+	0, //nb_inplace_and;
+	0, //nb_inplace_xor;
+	0, //nb_inplace_or;
+
+	(binaryfunc)variant_floordiv_slot<T>, //nb_floor_divide;
+	(binaryfunc)variant_truediv_slot<T>, //nb_true_divide;
+	0, //nb_inplace_floor_divide;
+	0, //nb_inplace_true_divide;
+
+	variant_traits<T>::exact ? (unaryfunc)variant_index<T> : 0, //nb_index;
+};
+#endif
+
+template<typename T>
+PyTypeObject variant_type<T>::type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	variant_traits<T>::qualified_name,             /* tp_name */
+	sizeof(example_class_variant<T>),             /* tp_basicsize */
+	0,                         /* tp_itemsize */
+	(destructor)variant_dealloc<T>, /* tp_dealloc */
+	0,                         /* tp_print */
+	0,                         /* tp_getattr */
+	0,                         /* tp_setattr */
+	0,                         /* tp_reserved */
+	(reprfunc)variant_repr<T>,                         /* tp_repr */
+	&variant_type<T>::number_methods,             /* tp_as_number */
+	&variant_type<T>::sequence_methods,                         /* tp_as_sequence */
+	0,                         /* tp_as_mapping */
+	(hashfunc)variant_hash<T>,                         /* tp_hash  */
+	0,                         /* tp_call */
+	0,                         /* tp_str */
+	0,                         /* tp_getattro */
+	0,                         /* tp_setattro */
+	0,                         /* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT |
+	Py_TPFLAGS_BASETYPE |
+	Py_TPFLAGS_CHECKTYPES,   /* tp_flags */
+	variant_type<T>::doc,           /* tp_doc */
+	0,                         /* tp_traverse */
+	0,                         /* tp_clear */
+	(richcmpfunc)variant_richcompare<T>,                         /* tp_richcompare */
+	0,                         /* tp_weaklistoffset */
+	0,                         /* tp_iter */
+	0,                         /* tp_iternext */
+	variant_type<T>::methods,             /* tp_methods */
+	variant_type<T>::members,             /* tp_members */
+	0,           			/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	0,      /* tp_init */
+	0,                         /* tp_alloc */
+	(newfunc)variant_new<T>,                 /* tp_new */
+};
+#endif
+
+// example_class_array
+
+static bool example_class_array_reserve(example_class_array * self, Py_ssize_t capacity) {
+	if (capacity <= self->allocated) {
+		return true;
+	}
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "cannot resize an example_class_array that is exporting buffers");
+		return false;
+	}
+	if ((size_t)capacity > PY_SSIZE_T_MAX / sizeof(double)) {
+		PyErr_NoMemory();
+		return false;
+	}
+	double* data = (double*)PyMem_Realloc(self->data, (size_t)capacity * sizeof(double));
+	if (data == NULL) {
+		PyErr_NoMemory();
+		return false;
+	}
+	self->data = data;
+	self->allocated = capacity;
+	return true;
+}
+
+static bool example_class_array_extend(template_state* state, example_class_array * self, PyObject * iterable) {
+	Py_buffer view;
+	char format;
+	if (get_numeric_buffer(iterable, &view, &format)) {
+		// bulk copy, the values never have to be boxed into Python objects
+		Py_ssize_t count = view.len / view.itemsize;
+		if (!example_class_array_reserve(self, self->length + count)) {
+			PyBuffer_Release(&view);
+			return false;
+		}
+		buffer_to_doubles(&view, format, self->data + self->length);
+		self->length += count;
+		PyBuffer_Release(&view);
+		return true;
+	}
+
+	PyObject* iterator = PyObject_GetIter(iterable);
+	if (iterator == NULL) {
+		return false;
+	}
+
+#if PY_VERSION_HEX >= 0x03040000
+	Py_ssize_t hint = PyObject_LengthHint(iterable, 0);
+	if (hint < 0 || !example_class_array_reserve(self, self->length + hint)) {
+		Py_DECREF(iterator);
+		return false;
+	}
+#endif
+
+	PyObject* item;
+	while ((item = PyIter_Next(iterator)) != NULL) {
+		internal_example_class o;
+		if (!unpack_example_class(state, item, &o)) {
+			if (!PyErr_Occurred()) {
+				Py_RAISE_TYPEERROR_O("must be a real number, not ", item);
+			}
+			Py_DECREF(item);
+			Py_DECREF(iterator);
+			return false;
+		}
+		Py_DECREF(item);
+		if (self->length == self->allocated && !example_class_array_reserve(self, self->allocated + (self->allocated >> 1) + 8)) {
+			Py_DECREF(iterator);
+			return false;
+		}
+		self->data[self->length++] = o.value;
+	}
+	Py_DECREF(iterator);
+	return !PyErr_Occurred();
+}
+
+static example_class_array* pack_example_class_array(template_state* state, const double* data, Py_ssize_t length) {
+	PyTypeObject* type = state->example_class_array_type;
+	example_class_array* out = (example_class_array*)type->tp_alloc(type, 0);
+
+	if (out != NULL && length > 0) {
+		if (!example_class_array_reserve(out, length)) {
+			Py_DECREF(out);
+			return NULL;
+		}
+		if (data != NULL) {
+			memcpy(out->data, data, (size_t)length * sizeof(double));
+		}
+		out->length = length;
+	}
+
+	return out;
+}
+
+static void
+example_class_array_dealloc(example_class_array* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+	PyMem_Free(self->data);
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+static PyObject *
+example_class_array_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	example_class_array *self;
+
+	self = (example_class_array *)type->tp_alloc(type, 0);
+	if (self != NULL) {
+		self->length = 0;
+		self->allocated = 0;
+		self->exports = 0;
+		self->data = NULL;
+	}
+
+	return (PyObject *)self;
+}
+
+static int
+example_class_array_init(example_class_array *self, PyObject *args, PyObject *kwargs)
+{
+	static char *kwlist[] = { (char*)"values", NULL };
+
+	PyObject * arg1 = NULL;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist,
+		&arg1)) {
+		return -1;
+	}
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "cannot reinitialize an example_class_array that is exporting buffers");
+		return -1;
+	}
+	self->length = 0;
+	if (arg1 == NULL) {
+		return 0;
+	}
+	if (!example_class_array_extend(template_state_of((PyObject*)self), self, arg1)) {
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject *
+example_class_array_repr(example_class_array* self)
+{
+	return format_doubles("example_class_array([", self->data, self->length, ", ", 2, "])", false);
+}
+
+static int
+example_class_array_getbuffer(example_class_array* self, Py_buffer* view, int flags)
+{
+	self->exports++;
+	return fill_double_buffer(view, (PyObject*)self, self->data, &self->length, flags);
+}
+
+static void
+example_class_array_releasebuffer(example_class_array* self, Py_buffer* view)
+{
+	self->exports--;
+}
+
+static Py_ssize_t example_class_array_len(example_class_array * self) {
+	return self->length;
+}
+
+static PyObject* example_class_array_sq_item(example_class_array * self, Py_ssize_t index) {
+	if (index < 0 || index >= self->length) {
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return NULL;
+	}
+	return pack_example_class(template_state_of((PyObject*)self), self->data[index]);
+}
+
+static int example_class_array_sq_setitem(example_class_array * self, Py_ssize_t index, PyObject * value) {
+	internal_example_class o;
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "example_class_array does not support item deletion");
+		return -1;
+	}
+	if (!unpack_example_class(template_state_of((PyObject*)self), value, &o)) {
+		if (!PyErr_Occurred()) {
+			Py_RAISE_TYPEERROR_O("must be a real number, not ", value);
+		}
+		return -1;
+	}
+	if (index < 0 || index >= self->length) {
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return -1;
+	}
+	self->data[index] = o.value;
+	return 0;
+}
+
+static int example_class_array_contains(example_class_array * self, PyObject * value) {
+	internal_example_class o;
+	if (!unpack_example_class(template_state_of((PyObject*)self), value, &o)) {
+		return PyErr_Occurred() ? -1 : 0;
+	}
+	for (Py_ssize_t i = 0; i < self->length; i++) {
+		if (self->data[i] == o.value) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static PyObject* example_class_array_subscript(example_class_array * self, PyObject * key) {
+	template_state* state = template_state_of((PyObject*)self);
+	if (PySlice_Check(key)) {
+		Py_ssize_t start, stop, step, slicelength;
+#if PY3K
+		if (PySlice_GetIndicesEx(key, self->length, &start, &stop, &step, &slicelength) < 0) {
+#else
+		if (PySlice_GetIndicesEx((PySliceObject*)key, self->length, &start, &stop, &step, &slicelength) < 0) {
+#endif
+			return NULL;
+		}
+		if (step == 1) {
+			return (PyObject*)pack_example_class_array(state, self->data + start, slicelength);
+		}
+		example_class_array* out = pack_example_class_array(state, NULL, slicelength);
+		if (out == NULL) {
+			return NULL;
+		}
+		for (Py_ssize_t i = 0; i < slicelength; i++, start += step) {
+			out->data[i] = self->data[start];
+		}
+		return (PyObject*)out;
+	}
+	if (PyIndex_Check(key)) {
+		Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
+		if (index == -1 && PyErr_Occurred()) {
+			return NULL;
+		}
+		if (index < 0) {
+			index += self->length;
+		}
+		return example_class_array_sq_item(self, index);
+	}
+	Py_RAISE_TYPEERROR_O("indices must be integers or slices, not ", key);
+	return NULL;
+}
+
+static int example_class_array_ass_subscript(example_class_array * self, PyObject * key, PyObject * value) {
+	template_state* state = template_state_of((PyObject*)self);
+	if (PySlice_Check(key)) {
+		Py_ssize_t start, stop, step, slicelength;
+		if (value == NULL) {
+			PyErr_SetString(PyExc_TypeError, "example_class_array does not support item deletion");
+			return -1;
+		}
+#if PY3K
+		if (PySlice_GetIndicesEx(key, self->length, &start, &stop, &step, &slicelength) < 0) {
+#else
+		if (PySlice_GetIndicesEx((PySliceObject*)key, self->length, &start, &stop, &step, &slicelength) < 0) {
+#endif
+			return -1;
+		}
+		example_class_array* values = pack_example_class_array(state, NULL, 0);
+		if (values == NULL) {
+			return -1;
+		}
+		if (!example_class_array_extend(state, values, value)) {
+			Py_DECREF(values);
+			return -1;
+		}
+		if (values->length != slicelength) {
+			PyErr_Format(PyExc_ValueError, "cannot assign %zd values to a slice of length %zd", values->length, slicelength);
+			Py_DECREF(values);
+			return -1;
+		}
+		for (Py_ssize_t i = 0; i < slicelength; i++, start += step) {
+			self->data[start] = values->data[i];
+		}
+		Py_DECREF(values);
+		return 0;
+	}
+	if (PyIndex_Check(key)) {
+		Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
+		if (index == -1 && PyErr_Occurred()) {
+			return -1;
+		}
+		if (index < 0) {
+			index += self->length;
+		}
+		return example_class_array_sq_setitem(self, index, value);
+	}
+	Py_RAISE_TYPEERROR_O("indices must be integers or slices, not ", key);
+	return -1;
+}
+
+// bulk conversion
+/* template.from_iterable() and to_floats() convert a whole sequence in one call into a list that is allocated
+ * at its final size and filled in place. The items of lists and tuples are read directly (the objects
+ * PySequence_Fast() would return), buffers of numbers are copied in bulk and other iterables are first collected
+ * into a temporary example_class_array, presized by their length hint.
+ */
+typedef PyObject* (*bulk_box)(template_state* state, double value);
+
+static PyObject* bulk_box_example_class(template_state* state, double value) {
+	return pack_example_class(state, value);
+}
+
+static PyObject* bulk_box_float(template_state* state, double value) {
+	return PyFloat_FromDouble(value);
+}
+
+static PyObject* bulk_convert(template_state* state, PyObject* obj, bulk_box box) {
+	PyObject* out = NULL;
+	if (PyList_Check(obj) || PyTuple_Check(obj)) {
+		Py_BEGIN_CRITICAL_SECTION(obj);
+		Py_ssize_t length = PySequence_Fast_GET_SIZE(obj);
+		out = PyList_New(length);
+		for (Py_ssize_t i = 0; out != NULL && i < length; i++) {
+			// converting an item may run Python code (__float__) that changes the list
+			if (PySequence_Fast_GET_SIZE(obj) != length) {
+				PyErr_SetString(PyExc_RuntimeError, "sequence changed size during conversion");
+				Py_CLEAR(out);
+				break;
+			}
+			PyObject* item = PySequence_Fast_GET_ITEM(obj, i);
+			internal_example_class o;
+			Py_INCREF(item);
+			bool ok = unpack_example_class(state, item, &o);
+			if (!ok && !PyErr_Occurred()) {
+				Py_RAISE_TYPEERROR_O("must be a real number, not ", item);
+			}
+			Py_DECREF(item);
+			PyObject* value = ok ? box(state, o.value) : NULL;
+			if (value == NULL) {
+				Py_CLEAR(out);
+				break;
+			}
+			PyList_SET_ITEM(out, i, value);
+		}
+		Py_END_CRITICAL_SECTION();
+		return out;
+	}
+
+	example_class_array* temp = pack_example_class_array(state, NULL, 0);
+	if (temp == NULL) {
+		return NULL;
+	}
+	if (example_class_array_extend(state, temp, obj)) {
+		out = PyList_New(temp->length);
+		for (Py_ssize_t i = 0; out != NULL && i < temp->length; i++) {
+			PyObject* value = box(state, temp->data[i]);
+			if (value == NULL) {
+				Py_CLEAR(out);
+				break;
+			}
+			PyList_SET_ITEM(out, i, value);
+		}
+	}
+	Py_DECREF(temp);
+	return out;
+}
+
+// serialization
+/* Values are serialized as little-endian IEEE 754 doubles.
+ * template.dumps() prefixes them with a 16 byte header:
+ *   0-3   magic b"TPLv"
+ *   4     format version
+ *   5     type code ('d')
+ *   6-7   reserved (0)
+ *   8-15  number of values (uint64, little-endian)
+ * so the values start 8 byte aligned whenever the header does (which is the case for bytes objects).
+ */
+#define SERIAL_MAGIC "TPLv"
+#define SERIAL_VERSION 1
+#define SERIAL_HEADER_SIZE 16
+
+static void store_doubles_le(const double* data, Py_ssize_t length, char* out) {
+#if PY_LITTLE_ENDIAN
+	memcpy(out, data, (size_t)length * sizeof(double));
+#else
+	for (Py_ssize_t i = 0; i < length; i++) {
+		uint64_t bits;
+		memcpy(&bits, data + i, sizeof(bits));
+		for (int b = 0; b < 8; b++) {
+			out[i * 8 + b] = (char)(bits >> (8 * b));
+		}
+	}
+#endif
+}
+
+static void load_doubles_le(const char* in, Py_ssize_t length, double* out) {
+#if PY_LITTLE_ENDIAN
+	memcpy(out, in, (size_t)length * sizeof(double));
+#else
+	for (Py_ssize_t i = 0; i < length; i++) {
+		uint64_t bits = 0;
+		for (int b = 0; b < 8; b++) {
+			bits |= (uint64_t)(unsigned char)in[i * 8 + b] << (8 * b);
+		}
+		memcpy(out + i, &bits, sizeof(bits));
+	}
+#endif
+}
+
+static PyObject* example_class_reduce(example_class* self, PyObject* unused) {
+	return Py_BuildValue("(O(d))", (PyObject*)Py_TYPE(self), example_class_load(self));
+}
+
+static PyObject* example_class_array_tobytes(example_class_array * self, PyObject * unused) {
+	PyObject* out = PyBytes_FromStringAndSize(NULL, self->length * (Py_ssize_t)sizeof(double));
+	if (out != NULL) {
+		store_doubles_le(self->data, self->length, PyBytes_AS_STRING(out));
+	}
+	return out;
+}
+
+static PyObject* example_class_array_frombytes(PyObject * cls, PyObject * data) {
+	Py_buffer view;
+	if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0) {
+		return NULL;
+	}
+	if (view.len % (Py_ssize_t)sizeof(double) != 0) {
+		PyBuffer_Release(&view);
+		PyErr_SetString(PyExc_ValueError, "buffer size must be a multiple of 8");
+		return NULL;
+	}
+	Py_ssize_t length = view.len / (Py_ssize_t)sizeof(double);
+	// an instance of cls, so that subclasses round-trip through pickle
+	PyTypeObject* type = (PyTypeObject*)cls;
+	example_class_array* out = (example_class_array*)type->tp_alloc(type, 0);
+	if (out != NULL && !example_class_array_reserve(out, length)) {
+		Py_CLEAR(out);
+	}
+	if (out != NULL) {
+		load_doubles_le((const char*)view.buf, length, out->data);
+		out->length = length;
+	}
+	PyBuffer_Release(&view);
+	return (PyObject*)out;
+}
+
+static PyObject* example_class_array_reduce_ex(example_class_array * self, PyObject * protocol) {
+	long proto = PyLong_AsLong(protocol);
+	if (proto == -1 && PyErr_Occurred()) {
+		return NULL;
+	}
+	PyObject* frombytes = PyObject_GetAttrString((PyObject*)Py_TYPE(self), "frombytes");
+	if (frombytes == NULL) {
+		return NULL;
+	}
+	PyObject* data;
+#if PY_VERSION_HEX >= 0x03080000 && PY_LITTLE_ENDIAN
+	if (proto >= 5) {
+		// lets pickle pass the values without copying them (out-of-band if a buffer_callback is given)
+		data = PyPickleBuffer_FromObject((PyObject*)self);
+	}
+	else
+#endif
+	{
+		data = example_class_array_tobytes(self, NULL);
+	}
+	if (data == NULL) {
+		Py_DECREF(frombytes);
+		return NULL;
+	}
+	return Py_BuildValue("(N(N))", frombytes, data);
+}
+
+// mapped_values
+/* A read-only, copy-on-write or read-write memory mapping of a file of doubles, either raw
+ * (any file whose size is a multiple of 8) or in the format written by template.dumps().
+ * Nothing is read until it is accessed, so files larger than the available memory can be used.
+ */
+
+static PyObject* mapped_values_closed_error(void) {
+	PyErr_SetString(PyExc_ValueError, "operation on a closed mapped_values");
+	return NULL;
+}
+
+static void mapped_values_unmap(mapped_values * self) {
+#ifdef _WIN32
+	if (self->base != NULL) {
+		UnmapViewOfFile(self->base);
+	}
+	if (self->mapping != NULL) {
+		CloseHandle(self->mapping);
+	}
+	if (self->file != INVALID_HANDLE_VALUE) {
+		CloseHandle(self->file);
+	}
+	self->mapping = NULL;
+	self->file = INVALID_HANDLE_VALUE;
+#else
+	if (self->base != NULL) {
+		munmap(self->base, self->map_length);
+	}
+#endif
+	self->base = NULL;
+	self->data = NULL;
+	self->map_length = 0;
+	self->length = 0;
+	self->closed = true;
+}
+
+static bool mapped_values_map(mapped_values * self, PyObject * path) {
+	// maps the whole file at <path> according to self->mode
+#ifdef _WIN32
+	PyObject* decoded;
+	if (!PyUnicode_FSDecoder(path, &decoded)) {
+		return false;
+	}
+	wchar_t* wpath = PyUnicode_AsWideCharString(decoded, NULL);
+	Py_DECREF(decoded);
+	if (wpath == NULL) {
+		return false;
+	}
+	DWORD access = (self->mode == MAPPED_WRITE) ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+	DWORD protect = (self->mode == MAPPED_READ) ? PAGE_READONLY : (self->mode == MAPPED_COPY) ? PAGE_WRITECOPY : PAGE_READWRITE;
+	DWORD view_access = (self->mode == MAPPED_READ) ? FILE_MAP_READ : (self->mode == MAPPED_COPY) ? FILE_MAP_COPY : FILE_MAP_WRITE;
+	LARGE_INTEGER size;
+	bool ok = false;
+	Py_BEGIN_ALLOW_THREADS
+	self->file = CreateFileW(wpath, access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (self->file != INVALID_HANDLE_VALUE && GetFileSizeEx(self->file, &size)) {
+		if (size.QuadPart == 0) {
+			ok = true; // empty files can't be mapped, but are valid (empty) arrays
+		}
+		else if ((unsigned long long)size.QuadPart <= (size_t)-1) {
+			self->mapping = CreateFileMappingW(self->file, NULL, protect, 0, 0, NULL);
+			if (self->mapping != NULL) {
+				self->base = (char*)MapViewOfFile(self->mapping, view_access, 0, 0, 0);
+				ok = self->base != NULL;
+			}
+		}
+		else {
+			SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		}
+	}
+	Py_END_ALLOW_THREADS
+	PyMem_Free(wpath);
+	if (!ok) {
+		PyErr_SetExcFromWindowsErrWithFilenameObject(PyExc_OSError, 0, path);
+		mapped_values_unmap(self);
+		return false;
+	}
+	self->map_length = (size_t)size.QuadPart;
+	return true;
+#else
+#if PY3K
+	PyObject* encoded;
+	if (!PyUnicode_FSConverter(path, &encoded)) {
+		return false;
+	}
+	const char* cpath = PyBytes_AS_STRING(encoded);
+#else
+	const char* cpath = PyString_AsString(path);
+	if (cpath == NULL) {
+		return false;
+	}
+#endif
+	int prot = (self->mode == MAPPED_READ) ? PROT_READ : PROT_READ | PROT_WRITE;
+	int flags = (self->mode == MAPPED_COPY) ? MAP_PRIVATE : MAP_SHARED;
+	int error = 0;
+	void* base = NULL;
+	struct stat st;
+	Py_BEGIN_ALLOW_THREADS
+	int fd = open(cpath, (self->mode == MAPPED_WRITE) ? O_RDWR : O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		error = errno;
+	}
+	else if (st.st_size > 0) {
+		if ((unsigned long long)st.st_size > (size_t)-1) {
+			error = ENOMEM;
+		}
+		else {
+			base = mmap(NULL, (size_t)st.st_size, prot, flags, fd, 0);
+			if (base == MAP_FAILED) {
+				error = errno;
+				base = NULL;
+			}
+		}
+	}
+	if (fd >= 0) {
+		close(fd); // the mapping keeps its own reference to the file
+	}
+	Py_END_ALLOW_THREADS
+#if PY3K
+	Py_DECREF(encoded);
+#endif
+	if (error != 0) {
+		errno = error;
+		PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+		return false;
+	}
+	self->base = (char*)base;
+	self->map_length = (base != NULL) ? (size_t)st.st_size : 0;
+	return true;
+#endif
+}
+
+static bool mapped_values_layout(mapped_values * self) {
+	// finds the values in the mapping, skipping the header of files written by template.dumps()
+	const unsigned char* p = (const unsigned char*)self->base;
+	size_t offset = 0;
+	if (self->map_length >= SERIAL_HEADER_SIZE && memcmp(p, SERIAL_MAGIC, 4) == 0) {
+		uint64_t count = 0;
+		for (int b = 0; b < 8; b++) {
+			count |= (uint64_t)p[8 + b] << (8 * b);
+		}
+		if (p[4] != SERIAL_VERSION || p[5] != 'd' || count != (self->map_length - SERIAL_HEADER_SIZE) / sizeof(double)
+			|| (self->map_length - SERIAL_HEADER_SIZE) % sizeof(double) != 0) {
+			PyErr_SetString(PyExc_ValueError, "file has a template.dumps() header that doesn't match its contents");
+			return false;
+		}
+		offset = SERIAL_HEADER_SIZE;
+	}
+	else if (self->map_length % sizeof(double) != 0) {
+		PyErr_SetString(PyExc_ValueError, "file size must be a multiple of 8 (or the file must be written by template.dumps())");
+		return false;
+	}
+	self->data = (self->base != NULL) ? (double*)(self->base + offset) : NULL;
+	self->length = (Py_ssize_t)((self->map_length - offset) / sizeof(double));
+	return true;
+}
+
+static PyObject *
+mapped_values_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	mapped_values *self;
+
+	self = (mapped_values *)type->tp_alloc(type, 0);
+	if (self != NULL) {
+		self->closed = true;
+#ifdef _WIN32
+		self->file = INVALID_HANDLE_VALUE;
+#endif
+	}
+
+	return (PyObject *)self;
+}
+
+static int
+mapped_values_init(mapped_values *self, PyObject *args, PyObject *kwargs)
+{
+	static char *kwlist[] = { (char*)"path", (char*)"mode", NULL };
+
+	PyObject * path = NULL;
+	const char * mode = "r";
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|s", kwlist,
+		&path, &mode)) {
+		return -1;
+	}
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "cannot reinitialize a mapped_values while its buffer is exported");
+		return -1;
+	}
+	mapped_mode parsed_mode;
+	if (strcmp(mode, "r") == 0) {
+		parsed_mode = MAPPED_READ;
+	}
+	else if (strcmp(mode, "c") == 0) {
+		parsed_mode = MAPPED_COPY;
+	}
+	else if (strcmp(mode, "r+") == 0) {
+		parsed_mode = MAPPED_WRITE;
+	}
+	else {
+		PyErr_Format(PyExc_ValueError, "mode must be 'r', 'c' or 'r+', not '%s'", mode);
+		return -1;
+	}
+#if !PY_LITTLE_ENDIAN
+	PyErr_SetString(PyExc_ValueError, "mapped_values requires a little-endian platform");
+	return -1;
+#endif
+	mapped_values_unmap(self);
+	self->mode = parsed_mode;
+	if (!mapped_values_map(self, path)) {
+		return -1;
+	}
+	self->closed = false;
+	if (!mapped_values_layout(self)) {
+		mapped_values_unmap(self);
+		return -1;
+	}
+	Py_INCREF(path);
+	Py_XSETREF(self->path, path);
+	return 0;
+}
+
+static void
+mapped_values_dealloc(mapped_values* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+	mapped_values_unmap(self);
+	Py_XDECREF(self->path);
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+static PyObject *
+mapped_values_repr(mapped_values* self)
+{
+	static const char* mode_names[] = { "r", "c", "r+" };
+	PyObject* path = (self->path != NULL) ? self->path : Py_None;
+#if PY3K
+	return PyUnicode_FromFormat("mapped_values(%R, mode='%s')%s", path, mode_names[self->mode], self->closed ? " (closed)" : "");
+#else
+	PyObject* out = PyString_FromString("mapped_values(");
+	PyString_ConcatAndDel(&out, PyObject_Repr(path));
+	PyString_ConcatAndDel(&out, PyString_FromFormat(", mode='%s')%s", mode_names[self->mode], self->closed ? " (closed)" : ""));
+	return out;
+#endif
+}
+
+static int
+mapped_values_getbuffer(mapped_values* self, Py_buffer* view, int flags)
+{
+	if (self->closed) {
+		mapped_values_closed_error();
+		view->obj = NULL;
+		return -1;
+	}
+	if (self->mode == MAPPED_READ && (flags & PyBUF_WRITABLE)) {
+		PyErr_SetString(PyExc_BufferError, "mapped_values opened with mode 'r' is read-only");
+		view->obj = NULL;
+		return -1;
+	}
+	self->exports++;
+	fill_double_buffer(view, (PyObject*)self, self->data, &self->length, flags);
+	view->readonly = (self->mode == MAPPED_READ);
+	return 0;
+}
+
+static void
+mapped_values_releasebuffer(mapped_values* self, Py_buffer* view)
+{
+	self->exports--;
+}
+
+static Py_ssize_t mapped_values_len(mapped_values * self) {
+	if (self->closed) {
+		mapped_values_closed_error();
+		return -1;
+	}
+	return self->length;
+}
+
+static PyObject* mapped_values_sq_item(mapped_values * self, Py_ssize_t index) {
+	if (self->closed) {
+		return mapped_values_closed_error();
+	}
+	if (index < 0 || index >= self->length) {
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return NULL;
+	}
+	return pack_example_class(template_state_of((PyObject*)self), self->data[index]);
+}
+
+static int mapped_values_sq_setitem(mapped_values * self, Py_ssize_t index, PyObject * value) {
+	internal_example_class o;
+	if (self->closed) {
+		mapped_values_closed_error();
+		return -1;
+	}
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "mapped_values does not support item deletion");
+		return -1;
+	}
+	if (self->mode == MAPPED_READ) {
+		PyErr_SetString(PyExc_TypeError, "mapped_values opened with mode 'r' is read-only");
+		return -1;
+	}
+	if (!unpack_example_class(template_state_of((PyObject*)self), value, &o)) {
+		if (!PyErr_Occurred()) {
+			Py_RAISE_TYPEERROR_O("must be a real number, not ", value);
+		}
+		return -1;
+	}
+	if (index < 0 || index >= self->length) {
+		PyErr_SetString(PyExc_IndexError, "index out of range");
+		return -1;
+	}
+	self->data[index] = o.value;
+	return 0;
+}
+
+static PyObject* mapped_values_subscript(mapped_values * self, PyObject * key) {
+	// slices are copied into an example_class_array
+	template_state* state = template_state_of((PyObject*)self);
+	if (self->closed) {
+		return mapped_values_closed_error();
+	}
+	if (PySlice_Check(key)) {
+		Py_ssize_t start, stop, step, slicelength;
+#if PY3K
+		if (PySlice_GetIndicesEx(key, self->length, &start, &stop, &step, &slicelength) < 0) {
+#else
+		if (PySlice_GetIndicesEx((PySliceObject*)key, self->length, &start, &stop, &step, &slicelength) < 0) {
+#endif
+			return NULL;
+		}
+		if (step == 1) {
+			return (PyObject*)pack_example_class_array(state, self->data + start, slicelength);
+		}
+		example_class_array* out = pack_example_class_array(state, NULL, slicelength);
+		if (out == NULL) {
+			return NULL;
+		}
+		for (Py_ssize_t i = 0; i < slicelength; i++, start += step) {
+			out->data[i] = self->data[start];
+		}
+		return (PyObject*)out;
+	}
+	if (PyIndex_Check(key)) {
+		Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
+		if (index == -1 && PyErr_Occurred()) {
+			return NULL;
+		}
+		if (index < 0) {
+			index += self->length;
+		}
+		return mapped_values_sq_item(self, index);
+	}
+	Py_RAISE_TYPEERROR_O("indices must be integers or slices, not ", key);
+	return NULL;
+}
+
+static PyObject* mapped_values_flush(mapped_values * self, PyObject * unused) {
+	// only 'r+' mappings write back to the file, copy-on-write changes stay private
+	if (self->closed) {
+		return mapped_values_closed_error();
+	}
+	if (self->mode != MAPPED_WRITE || self->base == NULL) {
+		Py_RETURN_NONE;
+	}
+	bool ok;
+	Py_BEGIN_ALLOW_THREADS
+#ifdef _WIN32
+	ok = FlushViewOfFile(self->base, 0) && FlushFileBuffers(self->file);
+#else
+	ok = msync(self->base, self->map_length, MS_SYNC) == 0;
+#endif
+	Py_END_ALLOW_THREADS
+	if (!ok) {
+#ifdef _WIN32
+		return PyErr_SetFromWindowsErr(0);
+#else
+		return PyErr_SetFromErrno(PyExc_OSError);
+#endif
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject* mapped_values_advise(mapped_values * self, PyObject * hint) {
+	/* Tells the kernel how the mapping will be accessed: 'normal', 'sequential', 'random',
+	 * 'willneed' (read ahead now) or 'dontneed' (the pages may be dropped).
+	 * This is only a hint, on Windows it has no effect.
+	 */
+	static const char* names[] = { "normal", "sequential", "random", "willneed", "dontneed", NULL };
+#ifndef _WIN32
+	static const int advice[] = { POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM, POSIX_MADV_WILLNEED, POSIX_MADV_DONTNEED };
+#endif
+	if (self->closed) {
+		return mapped_values_closed_error();
+	}
+#if PY3K
+	const char* name = PyUnicode_Check(hint) ? PyUnicode_AsUTF8(hint) : NULL;
+#else
+	const char* name = PyString_Check(hint) ? PyString_AsString(hint) : NULL;
+#endif
+	if (name == NULL) {
+		if (!PyErr_Occurred()) {
+			Py_RAISE_TYPEERROR_O("hint must be a str, not ", hint);
+		}
+		return NULL;
+	}
+	int i;
+	for (i = 0; names[i] != NULL; i++) {
+		if (strcmp(name, names[i]) == 0) {
+			break;
+		}
+	}
+	if (names[i] == NULL) {
+		PyErr_Format(PyExc_ValueError, "unknown hint '%s', expected 'normal', 'sequential', 'random', 'willneed' or 'dontneed'", name);
+		return NULL;
+	}
+#ifndef _WIN32
+	if (self->base != NULL) {
+		int error = posix_madvise(self->base, self->map_length, advice[i]);
+		if (error != 0) {
+			errno = error;
+			return PyErr_SetFromErrno(PyExc_OSError);
+		}
+	}
+#endif
+	Py_RETURN_NONE;
+}
+
+static PyObject* mapped_values_close(mapped_values * self, PyObject * unused) {
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "cannot close a mapped_values while its buffer is exported");
+		return NULL;
+	}
+	mapped_values_unmap(self);
+	Py_RETURN_NONE;
+}
+
+static PyObject* mapped_values_enter(mapped_values * self, PyObject * unused) {
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+static PyObject* mapped_values_exit(mapped_values * self, PyObject * args) {
+	return mapped_values_close(self, NULL);
+}
+
+static PyObject* mapped_values_get_mode(mapped_values * self, void * closure) {
+	static const char* mode_names[] = { "r", "c", "r+" };
+#if PY3K
+	return PyUnicode_FromString(mode_names[self->mode]);
+#else
+	return PyString_FromString(mode_names[self->mode]);
+#endif
+}
+
+static PyObject* mapped_values_get_closed(mapped_values * self, void * closure) {
+	return PyBool_FromLong(self->closed);
+}
+
+// decimal parsing
+/* Converts decimal text to doubles without creating float objects, used by template.parse_many() and value_reader.
+ * Numbers with at most 19 digits whose mantissa fits into 53 bits and whose decimal exponent is within [-22, 22]
+ * are exact in double arithmetic (Clinger's fast path), which covers most real-world data.
+ * Everything else goes to std::from_chars where the standard library implements it for doubles
+ * (libstdc++ and MSVC use the Eisel-Lemire algorithm), otherwise to strtod. Either way the results are correctly rounded.
+ */
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define DECIMAL_FAST_PATH 1
+#else
+#define DECIMAL_FAST_PATH 0 // x87 extended precision would round twice
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2
+#define DECIMAL_SSE2 // SSE2 is part of the baseline, no runtime dispatch needed
+#endif
+
+static const double decimal_powers_of_ten[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool decimal_is_space(char c) {
+	return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static inline bool decimal_is_separator(char c, char sep) {
+	// <sep> 0 stands for any run of whitespace and commas
+	if (sep != 0) {
+		return c == sep;
+	}
+	return c == ',' || decimal_is_space(c);
+}
+
+static inline int decimal_bit_count(unsigned int x) {
+#if defined(__GNUC__)
+	return __builtin_popcount(x);
+#else
+	x = x - ((x >> 1) & 0x55555555u);
+	x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+	return (int)((((x + (x >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+#endif
+}
+
+static inline int decimal_lowest_bit(unsigned int x) {
+	// index of the lowest set bit, <x> must not be 0
+#if defined(__GNUC__)
+	return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (int)index;
+#else
+	int index = 0;
+	while (!(x & 1)) {
+		x >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+#ifdef DECIMAL_SSE2
+static inline unsigned int decimal_separator_mask(const char* p, char sep) {
+	// bit i is set if p[i] is a separator, for the 16 bytes at <p>
+	__m128i c = _mm_loadu_si128((const __m128i*)p);
+	if (sep != 0) {
+		return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(sep)));
+	}
+	__m128i control = _mm_sub_epi8(c, _mm_set1_epi8('\t')); // '\t' ... '\r' become 0 ... 4
+	__m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8('\r' - '\t')), control);
+	__m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8(',')));
+	return (unsigned int)_mm_movemask_epi8(_mm_or_si128(is_control, is_space));
+}
+#endif
+
+static Py_ssize_t decimal_find_separator(const char* buf, Py_ssize_t i, Py_ssize_t end, char sep) {
+	// returns the offset of the first separator in buf[i:end], or <end>
+#ifdef DECIMAL_SSE2
+	for (; end - i >= 16; i += 16) {
+		unsigned int mask = decimal_separator_mask(buf + i, sep);
+		if (mask != 0) {
+			return i + decimal_lowest_bit(mask);
+		}
+	}
+#endif
+	while (i < end && !decimal_is_separator(buf[i], sep)) {
+		i++;
+	}
+	return i;
+}
+
+static Py_ssize_t decimal_count_fields(const char* buf, Py_ssize_t length, char sep) {
+	/* Returns an upper bound of the number of values in buf[:length]:
+	 * the number of separators plus one for an explicit <sep>, otherwise the number of tokens.
+	 */
+	Py_ssize_t count = 0;
+	Py_ssize_t i = 0;
+	unsigned int previous = 1; // whether the byte before buf[i] is a separator
+#ifdef DECIMAL_SSE2
+	for (; length - i >= 16; i += 16) {
+		unsigned int mask = decimal_separator_mask(buf + i, sep);
+		if (sep != 0) {
+			count += decimal_bit_count(mask);
+		}
+		else {
+			count += decimal_bit_count(~mask & ((mask << 1) | previous) & 0xffff); // first bytes of tokens
+			previous = mask >> 15;
+		}
+	}
+#endif
+	for (; i < length; i++) {
+		unsigned int is_separator = decimal_is_separator(buf[i], sep);
+		count += (sep != 0) ? is_separator : (!is_separator && previous);
+		previous = is_separator;
+	}
+	return (sep != 0) ? count + 1 : count;
+}
+
+#if PY_LITTLE_ENDIAN
+static inline bool decimal_is_eight_digits(const char* p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return (((v + 0x4646464646464646ULL) | (v - 0x3030303030303030ULL)) & 0x8080808080808080ULL) == 0;
+}
+
+static inline uint64_t decimal_eight_digits(const char* p) {
+	// the value of the eight ASCII digits at <p>, combined pairwise within a 64-bit word
+	uint64_t v;
+	memcpy(&v, p, 8);
+	v -= 0x3030303030303030ULL;
+	v = (v * 10) + (v >> 8);
+	return (((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32)))
+		+ (((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
+}
+#endif
+
+static const char* decimal_digits(const char* p, const char* end, uint64_t* mantissa) {
+	// accumulates the digits at <p> into <mantissa> (modulo 2**64), returns the end of the digits
+#if PY_LITTLE_ENDIAN
+	while (end - p >= 8 && decimal_is_eight_digits(p)) {
+		*mantissa = *mantissa * 100000000 + decimal_eight_digits(p);
+		p += 8;
+	}
+#endif
+	while (p < end && (unsigned char)(*p - '0') <= 9) {
+		*mantissa = *mantissa * 10 + (uint64_t)(*p - '0');
+		p++;
+	}
+	return p;
+}
+
+static bool decimal_parse_slow(const char* p, const char* end, double* out) {
+	// correctly rounded conversion of the complete token [p, end), returns false if it is not a number
+	bool negative = p < end && *p == '-';
+	const char* unsigned_start = (p < end && (*p == '-' || *p == '+')) ? p + 1 : p;
+	if (unsigned_start == end || *unsigned_start == '-' || *unsigned_start == '+') {
+		return false;
+	}
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	std::from_chars_result result = std::from_chars(unsigned_start, end, *out);
+	if (result.ec == std::errc() && result.ptr == end) {
+		if (negative) {
+			*out = -*out;
+		}
+		return true;
+	}
+	if (result.ec != std::errc::result_out_of_range || result.ptr != end) {
+		return false;
+	}
+	// from_chars doesn't return a value on overflow and underflow, strtod returns inf or a (possibly zero) subnormal
+#endif
+	char small[64];
+	size_t length = (size_t)(end - p);
+	char* copy = (length < sizeof(small)) ? small : (char*)malloc(length + 1);
+	if (copy == NULL) {
+		return false;
+	}
+	memcpy(copy, p, length);
+	copy[length] = '\0';
+	char* parsed_end;
+	*out = strtod(copy, &parsed_end);
+	bool ok = parsed_end == copy + length;
+	if (copy != small) {
+		free(copy);
+	}
+	return ok;
+}
+
+static bool decimal_parse(const char* p, const char* end, double* out) {
+	/* Converts the complete token [p, end) to a double, returns false if it is not a number.
+	 * Doesn't need the GIL.
+	 */
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	uint64_t mantissa = 0;
+	const char* digits_start = p;
+	p = decimal_digits(p, end, &mantissa);
+	Py_ssize_t digit_count = p - digits_start;
+	int64_t exponent = 0;
+	if (p < end && *p == '.') {
+		const char* fraction = ++p;
+		p = decimal_digits(p, end, &mantissa);
+		exponent = -(int64_t)(p - fraction);
+		digit_count += p - fraction;
+	}
+	if (digit_count == 0) {
+		return decimal_parse_slow(start, end, out); // inf / nan, or not a number
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negative_exponent = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+')) {
+			p++;
+		}
+		if (p == end) {
+			return false;
+		}
+		int64_t e = 0;
+		for (; p < end && (unsigned char)(*p - '0') <= 9; p++) {
+			if (e < 100000) {
+				e = e * 10 + (*p - '0');
+			}
+		}
+		exponent += negative_exponent ? -e : e;
+	}
+	if (p != end) {
+		return false;
+	}
+	if (DECIMAL_FAST_PATH && digit_count <= 19 && mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+		double value = (double)mantissa;
+		value = (exponent < 0) ? value / decimal_powers_of_ten[-exponent] : value * decimal_powers_of_ten[exponent];
+		*out = negative ? -value : value;
+		return true;
+	}
+	return decimal_parse_slow(start, end, out);
+}
+
+static bool decimal_parse_fields(const char* buf, Py_ssize_t length, char sep, double* out, Py_ssize_t capacity, Py_ssize_t* count, Py_ssize_t* error) {
+	/* Parses all values in buf[:length] into <out>, which has room for <capacity> (from decimal_count_fields()) values.
+	 * With an explicit <sep>, the values are separated by exactly one <sep> and may be surrounded by whitespace;
+	 * only the last field may be empty. Otherwise any run of whitespace and commas separates them.
+	 * On failure, returns false and sets *error to the offset of the offending field,
+	 * or to -1 if buf holds more than <capacity> values (it was modified since they were counted).
+	 */
+	Py_ssize_t i = 0;
+	*count = 0;
+	for (;;) {
+		while (i < length && (sep != 0 ? decimal_is_space(buf[i]) && buf[i] != sep : decimal_is_separator(buf[i], 0))) {
+			i++;
+		}
+		Py_ssize_t j = decimal_find_separator(buf, i, length, sep);
+		Py_ssize_t token_end = j;
+		if (sep != 0) {
+			while (token_end > i && decimal_is_space(buf[token_end - 1])) {
+				token_end--;
+			}
+		}
+		if (i == token_end) {
+			if (sep == 0 || j == length) {
+				return true;
+			}
+			*error = i; // empty field
+			return false;
+		}
+		if (*count == capacity) {
+			*error = -1;
+			return false;
+		}
+		if (!decimal_parse(buf + i, buf + token_end, out + *count)) {
+			*error = i;
+			return false;
+		}
+		(*count)++;
+		if (j == length) {
+			return true;
+		}
+		i = j + (sep != 0);
+	}
+}
+
+// value_reader
+/* Reads values in chunks of at most <chunk_size> from a file descriptor, a file object or an iterator
+ * of str / bytes blocks, so arbitrarily large inputs can be processed in bounded memory.
+ * Text input is a sequence of decimal floats separated by whitespace and/or commas,
+ * binary input is a sequence of little-endian doubles (as written by example_class_array.tobytes()).
+ * The GIL is released while reading from file descriptors and while parsing.
+ */
+#define READER_BLOCK_SIZE 65536 // bytes requested from the source at a time (text input)
+
+static bool reader_is_separator(char c) {
+	return decimal_is_separator(c, 0);
+}
+
+static bool reader_parse_text(const char* buf, Py_ssize_t* start, Py_ssize_t end, bool final, double* out, Py_ssize_t max, Py_ssize_t* count) {
+	/* Parses the tokens in buf[*start:end] into <out> until it holds <max> values.
+	 * A token that reaches <end> is left for the next call unless <final> is set, since it may continue in the next block.
+	 * Returns false if a token is not a number, *start is then the offset of that token.
+	 */
+	Py_ssize_t i = *start;
+	while (*count < max) {
+		while (i < end && reader_is_separator(buf[i])) {
+			i++;
+		}
+		if (i == end) {
+			break;
+		}
+		Py_ssize_t j = decimal_find_separator(buf, i, end, 0);
+		if (j == end && !final) {
+			break;
+		}
+		if (!decimal_parse(buf + i, buf + j, out + *count)) {
+			*start = i;
+			return false;
+		}
+		(*count)++;
+		i = j;
+	}
+	*start = i;
+	return true;
+}
+
+static bool value_reader_reserve(value_reader * self, Py_ssize_t extra) {
+	// moves the unparsed input to the front of the buffer and makes room for <extra> more bytes after it
+	if (self->raw_start > 0) {
+		memmove(self->raw, self->raw + self->raw_start, (size_t)(self->raw_end - self->raw_start));
+		self->raw_end -= self->raw_start;
+		self->offset += self->raw_start;
+		self->raw_start = 0;
+	}
+	if (self->raw_end + extra > self->raw_size) {
+		Py_ssize_t size = std::max(self->raw_size * 2, self->raw_end + extra);
+		char* raw = (char*)PyMem_Realloc(self->raw, (size_t)size + 1);
+		if (raw == NULL) {
+			PyErr_NoMemory();
+			return false;
+		}
+		self->raw = raw;
+		self->raw_size = size;
+	}
+	return true;
+}
+
+static bool value_reader_append(value_reader * self, const char* data, Py_ssize_t length) {
+	if (!value_reader_reserve(self, length)) {
+		return false;
+	}
+	memcpy(self->raw + self->raw_end, data, (size_t)length);
+	self->raw_end += length;
+	self->raw[self->raw_end] = '\0';
+	return true;
+}
+
+static bool value_reader_append_object(value_reader * self, PyObject * item) {
+	// appends a str or bytes-like block, or a number (formatted as text, or as 8 bytes in binary mode)
+	template_state* state = template_state_of((PyObject*)self);
+#if PY3K
+	if (PyUnicode_Check(item)) {
+		Py_ssize_t length;
+		const char* data = PyUnicode_AsUTF8AndSize(item, &length);
+		return data != NULL && value_reader_append(self, data, length);
+	}
+#endif
+	if (PyObject_CheckBuffer(item) && !PyObject_TypeCheck(item, state->example_class_type)) {
+		Py_buffer view;
+		if (PyObject_GetBuffer(item, &view, PyBUF_SIMPLE) < 0) {
+			return false;
+		}
+		bool ok = value_reader_append(self, (const char*)view.buf, view.len);
+		PyBuffer_Release(&view);
+		return ok;
+	}
+#if !PY3K
+	if (PyString_Check(item)) {
+		return value_reader_append(self, PyString_AS_STRING(item), PyString_GET_SIZE(item));
+	}
+#endif
+	internal_example_class o;
+	if (!unpack_example_class(state, item, &o)) {
+		if (!PyErr_Occurred()) {
+			Py_RAISE_TYPEERROR_O("expected str, bytes or a real number, not ", item);
+		}
+		return false;
+	}
+	char buf[FORMAT_DOUBLE_MAX + 1];
+	if (self->binary) {
+		store_doubles_le(&o.value, 1, buf);
+		return value_reader_append(self, buf, sizeof(double));
+	}
+	int length = format_double(o.value, buf);
+	buf[length++] = ' ';
+	return value_reader_append(self, buf, length);
+}
+
+static Py_ssize_t value_reader_read_fd(value_reader * self, Py_ssize_t size) {
+	// reads up to <size> bytes from self->fd into the buffer, returns the number of bytes read or -1 on error
+	Py_ssize_t n;
+	int error;
+	do {
+		Py_BEGIN_ALLOW_THREADS
+#ifdef _WIN32
+		n = _read(self->fd, self->raw + self->raw_end, (unsigned int)std::min(size, (Py_ssize_t)INT_MAX));
+#else
+		n = read(self->fd, self->raw + self->raw_end, (size_t)size);
+#endif
+		error = errno;
+		Py_END_ALLOW_THREADS
+	} while (n < 0 && error == EINTR && PyErr_CheckSignals() == 0);
+	if (n < 0) {
+		if (!PyErr_Occurred()) {
+			errno = error;
+			PyErr_SetFromErrno(PyExc_OSError);
+		}
+		return -1;
+	}
+	return n;
+}
+
+static bool value_reader_fill(value_reader * self) {
+	// reads the next block of input, sets self->eof at the end of the input
+	Py_ssize_t block = self->binary ? self->chunk_size * (Py_ssize_t)sizeof(double) : READER_BLOCK_SIZE;
+	switch (self->kind) {
+	case READER_FD: {
+		if (!value_reader_reserve(self, block)) {
+			return false;
+		}
+		Py_ssize_t n = value_reader_read_fd(self, block);
+		if (n < 0) {
+			return false;
+		}
+		self->raw_end += n;
+		self->raw[self->raw_end] = '\0';
+		self->eof = n == 0;
+		return true;
+	}
+#if PY_VERSION_HEX >= 0x03030000
+	case READER_READINTO: {
+		if (!value_reader_reserve(self, block)) {
+			return false;
+		}
+		PyObject* target = PyMemoryView_FromMemory(self->raw + self->raw_end, block, PyBUF_WRITE);
+		if (target == NULL) {
+			return false;
+		}
+		PyObject* result = PyObject_CallMethod(self->source, "readinto", "O", target);
+		Py_DECREF(target);
+		if (result == NULL) {
+			return false;
+		}
+		Py_ssize_t n = (result == Py_None) ? 0 : PyNumber_AsSsize_t(result, PyExc_OverflowError);
+		Py_DECREF(result);
+		if (n == -1 && PyErr_Occurred()) {
+			return false;
+		}
+		if (n < 0 || n > block) {
+			PyErr_Format(PyExc_ValueError, "readinto() returned %zd, outside of [0, %zd]", n, block);
+			return false;
+		}
+		self->raw_end += n;
+		self->raw[self->raw_end] = '\0';
+		self->eof = n == 0;
+		return true;
+	}
+#endif
+	case READER_READ: {
+		PyObject* data = PyObject_CallMethod(self->source, "read", "n", block);
+		if (data == NULL) {
+			return false;
+		}
+		Py_ssize_t length = PyObject_Length(data);
+		bool ok = length >= 0 && value_reader_append_object(self, data);
+		Py_DECREF(data);
+		self->eof = length == 0;
+		return ok;
+	}
+	case READER_ITERATOR: {
+		PyObject* item = PyIter_Next(self->source);
+		if (item == NULL) {
+			self->eof = !PyErr_Occurred();
+			return self->eof;
+		}
+		bool ok = value_reader_append_object(self, item);
+		Py_DECREF(item);
+		return ok;
+	}
+	}
+	return false;
+}
+
+static bool value_reader_parse(value_reader * self, double * out, Py_ssize_t * count) {
+	// parses as many buffered values as fit into <out>, with the GIL released
+	bool ok;
+	Py_ssize_t start = self->raw_start;
+	Py_BEGIN_ALLOW_THREADS
+	if (self->binary) {
+		Py_ssize_t n = std::min((self->raw_end - start) / (Py_ssize_t)sizeof(double), self->chunk_size - *count);
+		load_doubles_le(self->raw + start, n, out + *count);
+		*count += n;
+		start += n * (Py_ssize_t)sizeof(double);
+		ok = true;
+	}
+	else {
+		ok = reader_parse_text(self->raw, &start, self->raw_end, self->eof, out, self->chunk_size, count);
+	}
+	Py_END_ALLOW_THREADS
+	self->raw_start = start;
+	if (!ok) {
+		char token[41];
+		Py_ssize_t length = 0;
+		while (start + length < self->raw_end && length < 40 && !reader_is_separator(self->raw[start + length])) {
+			token[length] = self->raw[start + length];
+			length++;
+		}
+		token[length] = '\0';
+		PyErr_Format(PyExc_ValueError, "could not convert '%s' to float (at byte %zd)", token, self->offset + start);
+		return false;
+	}
+	return true;
+}
+
+static PyObject *
+value_reader_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	value_reader *self;
+
+	self = (value_reader *)type->tp_alloc(type, 0);
+	if (self != NULL) {
+		self->fd = -1;
+		self->eof = true;
+	}
+
+	return (PyObject *)self;
+}
+
+static int
+value_reader_init(value_reader *self, PyObject *args, PyObject *kwargs)
+{
+	static char *kwlist[] = { (char*)"source", (char*)"chunk_size", (char*)"binary", (char*)"reuse", NULL };
+
+	PyObject * source = NULL;
+	Py_ssize_t chunk_size = 65536;
+	int binary = 0;
+	int reuse = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nii", kwlist,
+		&source, &chunk_size, &binary, &reuse)) {
+		return -1;
+	}
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "value_reader is in use");
+		return -1;
+	}
+	if (chunk_size < 1 || chunk_size > PY_SSIZE_T_MAX / 2 / (Py_ssize_t)sizeof(double)) {
+		PyErr_SetString(PyExc_ValueError, "chunk_size must be positive");
+		return -1;
+	}
+	Py_CLEAR(self->source);
+	Py_CLEAR(self->chunk);
+	self->fd = -1;
+	if (PyIndex_Check(source) && !PyObject_TypeCheck(source, template_state_of((PyObject*)self)->example_class_type)) {
+		Py_ssize_t fd = PyNumber_AsSsize_t(source, PyExc_OverflowError);
+		if (fd == -1 && PyErr_Occurred()) {
+			return -1;
+		}
+		if (fd < 0 || fd > INT_MAX) {
+			PyErr_SetString(PyExc_ValueError, "file descriptor must be a non-negative int");
+			return -1;
+		}
+		self->kind = READER_FD;
+		self->fd = (int)fd;
+	}
+#if PY_VERSION_HEX >= 0x03030000
+	else if (PyObject_HasAttrString(source, "readinto")) {
+		self->kind = READER_READINTO;
+		Py_INCREF(source);
+		self->source = source;
+	}
+#endif
+	else if (PyObject_HasAttrString(source, "read")) {
+		self->kind = READER_READ;
+		Py_INCREF(source);
+		self->source = source;
+	}
+	else {
+		self->source = PyObject_GetIter(source);
+		if (self->source == NULL) {
+			return -1;
+		}
+		self->kind = READER_ITERATOR;
+	}
+	self->chunk_size = chunk_size;
+	self->binary = binary != 0;
+	self->reuse = reuse != 0;
+	self->eof = false;
+	self->raw_start = self->raw_end = 0;
+	self->offset = 0;
+	return 0;
+}
+
+static int
+value_reader_traverse(value_reader * self, visitproc visit, void * arg)
+{
+	Py_VISIT_HEAPTYPE(self);
+	Py_VISIT(self->source);
+	Py_VISIT(self->chunk);
+	return 0;
+}
+
+static int
+value_reader_clear(value_reader * self)
+{
+	Py_CLEAR(self->source);
+	Py_CLEAR(self->chunk);
+	return 0;
+}
+
+static void
+value_reader_dealloc(value_reader* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+	PyObject_GC_UnTrack(self);
+	value_reader_clear(self);
+	PyMem_Free(self->raw);
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+static PyObject *
+value_reader_next(value_reader *self)
+{
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "value_reader is already in use by another thread");
+		return NULL;
+	}
+	if (self->eof && self->raw_start == self->raw_end) {
+		return NULL;
+	}
+
+	// the previous chunk is only refilled if requested, and if nothing but the reader holds it
+	example_class_array* out = self->chunk;
+	if (out == NULL || out->exports > 0 || (!self->reuse && Py_REFCNT(out) > 1)) {
+		out = pack_example_class_array(template_state_of((PyObject*)self), NULL, 0);
+		if (out == NULL || !example_class_array_reserve(out, self->chunk_size)) {
+			Py_XDECREF(out);
+			return NULL;
+		}
+		Py_XSETREF(self->chunk, out);
+	}
+
+	// the chunk is pinned like an exported buffer while it is filled, since the caller may still hold it:
+	// reallocating it (slice assignment, __init__) from another thread would make the parser write into freed memory
+	Py_BEGIN_CRITICAL_SECTION(out);
+	out->exports++;
+	Py_END_CRITICAL_SECTION();
+	self->busy = true;
+	Py_ssize_t count = 0;
+	bool ok = true;
+	while (ok && count < self->chunk_size) {
+		ok = value_reader_parse(self, out->data, &count);
+		if (!ok || count == self->chunk_size) {
+			break;
+		}
+		if (self->eof) {
+			if (self->raw_start < self->raw_end) {
+				// only binary input can end with a partial value, text input is parsed completely at the end
+				PyErr_Format(PyExc_ValueError, "input ends with a partial value (%zd trailing bytes)", self->raw_end - self->raw_start);
+				self->raw_start = self->raw_end;
+				ok = false;
+			}
+			break;
+		}
+		ok = value_reader_fill(self);
+	}
+	self->busy = false;
+	Py_BEGIN_CRITICAL_SECTION(out);
+	out->exports--;
+	out->length = ok ? count : 0;
+	Py_END_CRITICAL_SECTION();
+
+	if (!ok) {
+		return NULL;
+	}
+	if (count == 0) {
+		return NULL;
+	}
+	Py_INCREF(out);
+	return (PyObject*)out;
+}
+
+// batch arithmetic
+/* Elementwise kernels over contiguous double buffers, used by template.add_many() and friends.
+ * The vectorizable operations have SSE2, AVX and AVX-512 versions which are selected at runtime
+ * depending on what the CPU supports. Only plain IEEE operations (and floor) are used, so the results
+ * are bit-identical to the scalar number slots. fmod and pow have no vector equivalent and always run scalar.
+ */
+typedef void(*batch_kernel)(const double* a, Py_ssize_t a_step, const double* b, Py_ssize_t b_step, double* out, Py_ssize_t n);
+
+enum batch_op { BATCH_ADD, BATCH_SUB, BATCH_MUL, BATCH_TRUEDIV, BATCH_FLOORDIV, BATCH_MOD, BATCH_POW, BATCH_OP_COUNT };
+
+enum batch_level { BATCH_LEVEL_SCALAR, BATCH_LEVEL_SSE2, BATCH_LEVEL_AVX, BATCH_LEVEL_AVX512, BATCH_LEVEL_COUNT };
+
+static const char* batch_level_names[BATCH_LEVEL_COUNT] = { "scalar", "sse2", "avx", "avx512" };
+
+// <a_step> and <b_step> are either 1 (an array operand) or 0 (a broadcast scalar operand)
+#define BATCH_SCALAR_KERNEL(name, expr) \
+static void name(const double* a, Py_ssize_t a_step, const double* b, Py_ssize_t b_step, double* out, Py_ssize_t n) { \
+	for (Py_ssize_t i = 0; i < n; i++) { \
+		double x = a[i * a_step], y = b[i * b_step]; \
+		out[i] = (expr); \
+	} \
+}
+
+BATCH_SCALAR_KERNEL(batch_add_scalar, x + y)
+BATCH_SCALAR_KERNEL(batch_sub_scalar, x - y)
+BATCH_SCALAR_KERNEL(batch_mul_scalar, x * y)
+BATCH_SCALAR_KERNEL(batch_truediv_scalar, x / y)
+BATCH_SCALAR_KERNEL(batch_floordiv_scalar, floor(x / y))
+BATCH_SCALAR_KERNEL(batch_mod_scalar, fmod(x, y))
+BATCH_SCALAR_KERNEL(batch_pow_scalar, pow(x, y))
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86
+#define BATCH_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define BATCH_X86
+#define BATCH_TARGET(isa)
+#endif
+
+// loops outside of the batch kernels get an AVX2 clone next to the baseline version, picked once by the dynamic
+// loader (GNU ifunc). AVX2 doesn't include FMA, so the clones round exactly like the baseline code.
+#if defined(BATCH_X86) && defined(__GNUC__) && defined(__linux__) && defined(__GLIBC__) && !defined(TEMPLATE_NO_CLONES) \
+	&& (defined(__clang__) ? __clang_major__ >= 14 : __GNUC__ >= 6)
+#define BATCH_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define BATCH_CLONES
+#endif
+
+#ifdef BATCH_X86
+#define BATCH_VECTOR_KERNEL(name, isa, vec, width, loadu, set1, storeu, vec_expr, expr) \
+static BATCH_TARGET(isa) void name(const double* a, Py_ssize_t a_step, const double* b, Py_ssize_t b_step, double* out, Py_ssize_t n) { \
+	Py_ssize_t i = 0; \
+	for (; i + width <= n; i += width) { \
+		vec x = a_step ? loadu(a + i) : set1(*a); \
+		vec y = b_step ? loadu(b + i) : set1(*b); \
+		storeu(out + i, vec_expr); \
+	} \
+	for (; i < n; i++) { \
+		double x = a[i * a_step], y = b[i * b_step]; \
+		out[i] = (expr); \
+	} \
+}
+
+#define BATCH_SSE2_KERNEL(name, vec_expr, expr) BATCH_VECTOR_KERNEL(name, "sse2", __m128d, 2, _mm_loadu_pd, _mm_set1_pd, _mm_storeu_pd, vec_expr, expr)
+#define BATCH_AVX_KERNEL(name, vec_expr, expr) BATCH_VECTOR_KERNEL(name, "avx", __m256d, 4, _mm256_loadu_pd, _mm256_set1_pd, _mm256_storeu_pd, vec_expr, expr)
+#define BATCH_AVX512_KERNEL(name, vec_expr, expr) BATCH_VECTOR_KERNEL(name, "avx512f", __m512d, 8, _mm512_loadu_pd, _mm512_set1_pd, _mm512_storeu_pd, vec_expr, expr)
+
+BATCH_SSE2_KERNEL(batch_add_sse2, _mm_add_pd(x, y), x + y)
+BATCH_SSE2_KERNEL(batch_sub_sse2, _mm_sub_pd(x, y), x - y)
+BATCH_SSE2_KERNEL(batch_mul_sse2, _mm_mul_pd(x, y), x * y)
+BATCH_SSE2_KERNEL(batch_truediv_sse2, _mm_div_pd(x, y), x / y)
+// SSE2 has no vector floor, floordiv uses the AVX kernel or the scalar one
+
+BATCH_AVX_KERNEL(batch_add_avx, _mm256_add_pd(x, y), x + y)
+BATCH_AVX_KERNEL(batch_sub_avx, _mm256_sub_pd(x, y), x - y)
+BATCH_AVX_KERNEL(batch_mul_avx, _mm256_mul_pd(x, y), x * y)
+BATCH_AVX_KERNEL(batch_truediv_avx, _mm256_div_pd(x, y), x / y)
+BATCH_AVX_KERNEL(batch_floordiv_avx, _mm256_floor_pd(_mm256_div_pd(x, y)), floor(x / y))
+
+static inline BATCH_TARGET("avx512f") __m512d batch_floor_avx512(__m512d v) {
+	return _mm512_mask_roundscale_pd(v, (__mmask8)0xFF, v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+BATCH_AVX512_KERNEL(batch_add_avx512, _mm512_add_pd(x, y), x + y)
+BATCH_AVX512_KERNEL(batch_sub_avx512, _mm512_sub_pd(x, y), x - y)
+BATCH_AVX512_KERNEL(batch_mul_avx512, _mm512_mul_pd(x, y), x * y)
+BATCH_AVX512_KERNEL(batch_truediv_avx512, _mm512_div_pd(x, y), x / y)
+BATCH_AVX512_KERNEL(batch_floordiv_avx512, batch_floor_avx512(_mm512_div_pd(x, y)), floor(x / y))
+#endif
+
+static const batch_kernel batch_kernel_table[BATCH_LEVEL_COUNT][BATCH_OP_COUNT] = {
+	{ batch_add_scalar, batch_sub_scalar, batch_mul_scalar, batch_truediv_scalar, batch_floordiv_scalar, batch_mod_scalar, batch_pow_scalar },
+#ifdef BATCH_X86
+	{ batch_add_sse2, batch_sub_sse2, batch_mul_sse2, batch_truediv_sse2, batch_floordiv_scalar, batch_mod_scalar, batch_pow_scalar },
+	{ batch_add_avx, batch_sub_avx, batch_mul_avx, batch_truediv_avx, batch_floordiv_avx, batch_mod_scalar, batch_pow_scalar },
+	{ batch_add_avx512, batch_sub_avx512, batch_mul_avx512, batch_truediv_avx512, batch_floordiv_avx512, batch_mod_scalar, batch_pow_scalar },
+#endif
+};
+
+// process-wide, shared by the module objects of all interpreters (which may run in parallel)
+static int batch_level_supported = BATCH_LEVEL_SCALAR; // highest level the CPU supports, set in batch_detect_level()
+static std::atomic<int> batch_level_current(BATCH_LEVEL_SCALAR);
+static std::once_flag batch_level_detected;
+
+static void batch_detect_level_once() {
+#if defined(BATCH_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		batch_level_supported = BATCH_LEVEL_AVX512;
+	}
+	else if (__builtin_cpu_supports("avx")) {
+		batch_level_supported = BATCH_LEVEL_AVX;
+	}
+	else if (__builtin_cpu_supports("sse2")) {
+		batch_level_supported = BATCH_LEVEL_SSE2;
+	}
+#elif defined(BATCH_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = osxsave && (info[2] & (1 << 28)) != 0;
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	avx = avx && (xcr0 & 0x6) == 0x6; // the OS saves the SSE and AVX registers
+	__cpuidex(info, 7, 0);
+	bool avx512 = avx && (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe0) == 0xe0;
+	batch_level_supported = avx512 ? BATCH_LEVEL_AVX512 : avx ? BATCH_LEVEL_AVX : sse2 ? BATCH_LEVEL_SSE2 : BATCH_LEVEL_SCALAR;
+#endif
+	batch_level_current = batch_level_supported;
+}
+
+static void batch_detect_level() {
+	std::call_once(batch_level_detected, batch_detect_level_once);
+}
+
+typedef struct {
+	Py_buffer view; // only valid if has_view is true
+	bool has_view;
+	PyObject* temp; // owns the converted values if the operand wasn't a buffer of doubles
+	const double* data; // points to <scalar> for scalar operands
+	Py_ssize_t length; // -1 for scalar operands
+	double scalar;
+} batch_operand;
+
+static bool batch_operand_get(template_state* state, PyObject* obj, batch_operand* op) {
+	/* Resolves <obj> into a contiguous run of doubles.
+	 * Single example_class compatible values are broadcast, buffers of doubles are used in place,
+	 * anything else is converted into a temporary example_class_array.
+	 */
+	internal_example_class o;
+	char format;
+
+	op->has_view = false;
+	op->temp = NULL;
+
+	if (unpack_example_class(state, obj, &o)) {
+		op->scalar = o.value;
+		op->data = &op->scalar;
+		op->length = -1;
+		return true;
+	}
+	if (PyErr_Occurred()) {
+		return false;
+	}
+	if (get_numeric_buffer(obj, &op->view, &format)) {
+		if (format == 'd') {
+			op->has_view = true;
+			op->data = (const double*)op->view.buf;
+			op->length = op->view.len / op->view.itemsize;
+			return true;
+		}
+		PyBuffer_Release(&op->view);
+	}
+	example_class_array* temp = pack_example_class_array(state, NULL, 0);
+	if (temp == NULL) {
+		return false;
+	}
+	if (!example_class_array_extend(state, temp, obj)) {
+		Py_DECREF(temp);
+		return false;
+	}
+	op->temp = (PyObject*)temp;
+	op->data = temp->data;
+	op->length = temp->length;
+	return true;
+}
+
+static void batch_operand_release(batch_operand* op) {
+	if (op->has_view) {
+		PyBuffer_Release(&op->view);
+		op->has_view = false;
+	}
+	Py_CLEAR(op->temp);
+}
+
+// operations on at least this many values release the GIL
+#define BATCH_RELEASE_GIL_THRESHOLD 4096
+
+static PyObject* batch_apply(template_state* state, batch_op op, PyObject* obj1, PyObject* obj2, PyObject* out) {
+	batch_operand o1, o2;
+
+	if (!batch_operand_get(state, obj1, &o1)) {
+		return NULL;
+	}
+	if (!batch_operand_get(state, obj2, &o2)) {
+		batch_operand_release(&o1);
+		return NULL;
+	}
+	if (o1.length >= 0 && o2.length >= 0 && o1.length != o2.length) {
+		PyErr_Format(PyExc_ValueError, "operands have different lengths (%zd and %zd)", o1.length, o2.length);
+		batch_operand_release(&o1);
+		batch_operand_release(&o2);
+		return NULL;
+	}
+	Py_ssize_t length = (o1.length >= 0) ? o1.length : (o2.length >= 0) ? o2.length : 1;
+
+	Py_buffer out_view;
+	double* out_data;
+	if (out == NULL || out == Py_None) {
+		out = (PyObject*)pack_example_class_array(state, NULL, length);
+		if (out == NULL) {
+			batch_operand_release(&o1);
+			batch_operand_release(&o2);
+			return NULL;
+		}
+		out_data = ((example_class_array*)out)->data;
+		out_view.obj = NULL;
+	}
+	else {
+		if (PyObject_GetBuffer(out, &out_view, PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+			batch_operand_release(&o1);
+			batch_operand_release(&o2);
+			return NULL;
+		}
+		if (buffer_native_format(&out_view) != 'd' || out_view.len / out_view.itemsize != length) {
+			PyErr_Format(PyExc_ValueError, "out must be a writable buffer of %zd doubles", length);
+			PyBuffer_Release(&out_view);
+			batch_operand_release(&o1);
+			batch_operand_release(&o2);
+			return NULL;
+		}
+		Py_INCREF(out);
+		out_data = (double*)out_view.buf;
+	}
+
+	batch_kernel kernel = batch_kernel_table[batch_level_current][op];
+	Py_ssize_t a_step = (o1.length >= 0) ? 1 : 0, b_step = (o2.length >= 0) ? 1 : 0;
+	if (length >= BATCH_RELEASE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		kernel(o1.data, a_step, o2.data, b_step, out_data, length);
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		kernel(o1.data, a_step, o2.data, b_step, out_data, length);
+	}
+
+	if (out_view.obj != NULL) {
+		PyBuffer_Release(&out_view);
+	}
+	batch_operand_release(&o1);
+	batch_operand_release(&o2);
+	return out;
+}
+
+// thread pool
+/* A small pool of worker threads shared by the functions that split large inputs (e.g. template.sum()).
+ * thread_pool_run() hands out task indices to the workers and the calling thread, so it must only be
+ * called with work that doesn't touch Python objects, usually with the GIL released.
+ */
+struct thread_pool_state {
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long long generation;
+	unsigned active; // workers that haven't finished the current generation yet
+	bool stop;
+	const std::function<void(Py_ssize_t)>* job;
+	Py_ssize_t tasks;
+	std::atomic<Py_ssize_t> next_task;
+
+	thread_pool_state() : generation(0), active(0), stop(false), job(NULL), tasks(0), next_task(0) {}
+};
+
+static void thread_pool_work(thread_pool_state* state) {
+	for (;;) {
+		Py_ssize_t task = state->next_task.fetch_add(1);
+		if (task >= state->tasks) {
+			return;
+		}
+		(*state->job)(task);
+	}
+}
+
+static void thread_pool_worker(std::shared_ptr<thread_pool_state> state) {
+	unsigned long long seen = 0;
+	std::unique_lock<std::mutex> lock(state->mutex);
+	for (;;) {
+		state->wake.wait(lock, [&] { return state->stop || state->generation != seen; });
+		if (state->stop) {
+			return;
+		}
+		seen = state->generation;
+		lock.unlock();
+		thread_pool_work(state.get());
+		lock.lock();
+		if (--state->active == 0) {
+			state->done.notify_one();
+		}
+	}
+}
+
+static std::mutex thread_pool_mutex; // serializes thread_pool_run() and reconfiguration
+static std::shared_ptr<thread_pool_state> thread_pool;
+static unsigned thread_pool_workers = 0; // number of worker threads in <thread_pool>
+static unsigned thread_pool_size = 0; // number of threads used, including the calling one (0 = not configured yet)
+#ifndef _WIN32
+static pid_t thread_pool_pid = 0; // a forked child doesn't inherit the worker threads
+#endif
+
+static void thread_pool_retire() {
+	// stops the workers of the current pool, thread_pool_mutex must be held
+	if (thread_pool) {
+		{
+			std::lock_guard<std::mutex> lock(thread_pool->mutex);
+			thread_pool->stop = true;
+		}
+		thread_pool->wake.notify_all();
+		thread_pool.reset();
+	}
+}
+
+static unsigned thread_pool_get_size() {
+	// thread_pool_mutex must be held
+	if (thread_pool_size == 0) {
+		unsigned size = std::thread::hardware_concurrency();
+		thread_pool_size = (size > 0) ? size : 1;
+	}
+	return thread_pool_size;
+}
+
+static void thread_pool_run(Py_ssize_t tasks, const std::function<void(Py_ssize_t)>& job) {
+	// calls job(0) ... job(tasks - 1), spread over the pool
+	std::lock_guard<std::mutex> guard(thread_pool_mutex);
+	unsigned size = thread_pool_get_size();
+
+#ifndef _WIN32
+	if (thread_pool && thread_pool_pid != getpid()) {
+		// the threads are gone, drop the pool without waking anyone
+		thread_pool.reset();
+	}
+#endif
+	if (!thread_pool && size > 1 && tasks > 1) {
+		std::shared_ptr<thread_pool_state> state = std::make_shared<thread_pool_state>();
+		unsigned started = 0;
+		try {
+			for (; started < size - 1; started++) {
+				std::thread(thread_pool_worker, state).detach();
+			}
+		}
+		catch (const std::system_error&) {
+			// run with the threads we got
+		}
+		if (started > 0) {
+			thread_pool = state;
+			thread_pool_workers = started;
+#ifndef _WIN32
+			thread_pool_pid = getpid();
+#endif
+		}
+	}
+	if (!thread_pool || tasks <= 1) {
+		for (Py_ssize_t i = 0; i < tasks; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	thread_pool_state* state = thread_pool.get();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->job = &job;
+	state->tasks = tasks;
+	state->next_task = 0;
+	state->active = thread_pool_workers;
+	state->generation++;
+	lock.unlock();
+	state->wake.notify_all();
+
+	thread_pool_work(state);
+
+	lock.lock();
+	state->done.wait(lock, [&] { return state->active == 0; });
+	state->job = NULL;
+}
+
+// reductions
+/* template.sum(), min(), max(), mean() and dot().
+ * The input is cut into blocks of a fixed size which are reduced independently (in parallel for large inputs)
+ * and then combined in order, so the results don't depend on the number of threads.
+ * Sums use pairwise summation, both inside the blocks and across them.
+ */
+#define REDUCE_BLOCK_SIZE 16384
+#define REDUCE_PARALLEL_THRESHOLD (16 * REDUCE_BLOCK_SIZE) // smaller inputs are reduced on the calling thread
+
+struct reduce_values {
+	const double* a;
+	double operator()(Py_ssize_t i) const { return a[i]; }
+};
+
+struct reduce_products {
+	const double* a;
+	const double* b;
+	double operator()(Py_ssize_t i) const { return a[i] * b[i]; }
+};
+
+template<typename Items>
+static BATCH_CLONES double pairwise_sum(const Items& items, Py_ssize_t start, Py_ssize_t n) {
+	if (n < 8) {
+		double sum = 0.0;
+		for (Py_ssize_t i = 0; i < n; i++) {
+			sum += items(start + i);
+		}
+		return sum;
+	}
+	if (n <= 128) {
+		double r[8];
+		for (int j = 0; j < 8; j++) {
+			r[j] = items(start + j);
+		}
+		Py_ssize_t i;
+		for (i = 8; i < n - (n % 8); i += 8) {
+			for (int j = 0; j < 8; j++) {
+				r[j] += items(start + i + j);
+			}
+		}
+		double sum = ((r[0] + r[1]) + (r[2] + r[3])) + ((r[4] + r[5]) + (r[6] + r[7]));
+		for (; i < n; i++) {
+			sum += items(start + i);
+		}
+		return sum;
+	}
+	Py_ssize_t half = n / 2;
+	half -= half % 8;
+	return pairwise_sum(items, start, half) + pairwise_sum(items, start + half, n - half);
+}
+
+template<typename Items>
+static double blocked_sum(const Items& items, Py_ssize_t n) {
+	Py_ssize_t blocks = (n + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+	std::vector<double> partial((size_t)blocks);
+	std::function<void(Py_ssize_t)> job = [&](Py_ssize_t block) {
+		Py_ssize_t start = block * REDUCE_BLOCK_SIZE;
+		partial[(size_t)block] = pairwise_sum(items, start, std::min<Py_ssize_t>(REDUCE_BLOCK_SIZE, n - start));
+	};
+	if (n >= REDUCE_PARALLEL_THRESHOLD) {
+		thread_pool_run(blocks, job);
+	}
+	else {
+		for (Py_ssize_t block = 0; block < blocks; block++) {
+			job(block);
+		}
+	}
+	reduce_values partial_items = { partial.data() };
+	return pairwise_sum(partial_items, 0, blocks);
+}
+
+typedef struct {
+	double value;
+	bool nan;
+} reduce_extreme;
+
+static reduce_extreme extreme_of(const double* a, Py_ssize_t n, bool maximum) {
+	// the first occurrence wins ties (e.g. 0.0 and -0.0), any NaN makes the result NaN
+	reduce_extreme out = { a[0], a[0] != a[0] };
+	for (Py_ssize_t i = 1; i < n; i++) {
+		double x = a[i];
+		if (maximum ? (x > out.value) : (x < out.value)) {
+			out.value = x;
+		}
+		else if (x != x) {
+			out.nan = true;
+		}
+	}
+	return out;
+}
+
+static double blocked_extreme(const double* a, Py_ssize_t n, bool maximum) {
+	Py_ssize_t blocks = (n + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+	std::vector<reduce_extreme> partial((size_t)blocks);
+	std::function<void(Py_ssize_t)> job = [&](Py_ssize_t block) {
+		Py_ssize_t start = block * REDUCE_BLOCK_SIZE;
+		partial[(size_t)block] = extreme_of(a + start, std::min<Py_ssize_t>(REDUCE_BLOCK_SIZE, n - start), maximum);
+	};
+	if (n >= REDUCE_PARALLEL_THRESHOLD) {
+		thread_pool_run(blocks, job);
+	}
+	else {
+		for (Py_ssize_t block = 0; block < blocks; block++) {
+			job(block);
+		}
+	}
+	reduce_extreme out = partial[0];
+	for (size_t i = 1; i < partial.size(); i++) {
+		if (maximum ? (partial[i].value > out.value) : (partial[i].value < out.value)) {
+			out.value = partial[i].value;
+		}
+		out.nan = out.nan || partial[i].nan;
+	}
+	return out.nan ? Py_NAN : out.value;
+}
+
+enum reduce_op { REDUCE_SUM, REDUCE_MIN, REDUCE_MAX, REDUCE_MEAN };
+
+static bool reduce_operand_get(template_state* state, PyObject* obj, batch_operand* op) {
+	if (!batch_operand_get(state, obj, op)) {
+		return false;
+	}
+	if (op->length < 0) {
+		Py_RAISE_TYPEERROR_O("expected a buffer or an iterable of values, not ", obj);
+		return false;
+	}
+	return true;
+}
+
+static PyObject* reduce_apply(template_state* state, reduce_op op, PyObject* obj) {
+	batch_operand o;
+	double result = 0.0;
+
+	if (!reduce_operand_get(state, obj, &o)) {
+		return NULL;
+	}
+	if (o.length == 0 && op != REDUCE_SUM) {
+		batch_operand_release(&o);
+		PyErr_SetString(PyExc_ValueError, (op == REDUCE_MEAN) ? "mean of an empty sequence" : "min/max of an empty sequence");
+		return NULL;
+	}
+
+	auto compute = [&] {
+		switch (op) {
+		case REDUCE_SUM:
+		case REDUCE_MEAN: {
+			reduce_values items = { o.data };
+			result = blocked_sum(items, o.length);
+			if (op == REDUCE_MEAN) {
+				result /= (double)o.length;
+			}
+			break;
+		}
+		case REDUCE_MIN:
+		case REDUCE_MAX:
+			result = blocked_extreme(o.data, o.length, op == REDUCE_MAX);
+			break;
+		}
+	};
+	if (o.length >= BATCH_RELEASE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		compute();
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		compute();
+	}
+
+	batch_operand_release(&o);
+	return pack_example_class(state, result);
+}
+
+// sorting
+/* template.sort(), argsort(), topk() and searchsorted().
+ * Values are ordered the way example_class_richcompare() orders them: -0.0 and 0.0 are equal and keep their
+ * input order (all sorts are stable), NaNs compare false to everything and go after all other values,
+ * in either direction. The values are mapped to unsigned integer keys with that order (sort_key())
+ * and sorted by an LSD radix sort, one byte per pass. Passes in which all keys share the same byte are skipped.
+ * Large inputs are sorted in parallel: every pass counts the digits of each block,
+ * then the blocks scatter their keys to disjoint ranges of the output.
+ */
+#define SORT_RADIX_BITS 8
+#define SORT_BUCKETS (1 << SORT_RADIX_BITS)
+#define SORT_PASSES (64 / SORT_RADIX_BITS)
+#define SORT_BLOCK_SIZE 65536
+#define SORT_PARALLEL_THRESHOLD (4 * SORT_BLOCK_SIZE) // smaller inputs are sorted on the calling thread
+
+static inline uint64_t sort_key(double value, bool descending) {
+	if (value != value) {
+		return UINT64_MAX;
+	}
+	if (value == 0.0) {
+		value = 0.0;
+	}
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits = (bits >> 63) ? ~bits : bits | ((uint64_t)1 << 63);
+	return descending ? ~bits : bits;
+}
+
+static inline double sort_value(uint64_t key, bool descending) {
+	// inverse of sort_key() for anything but zeros and NaNs (which lose their sign and payload)
+	if (descending) {
+		key = ~key;
+	}
+	key = (key >> 63) ? key & ~((uint64_t)1 << 63) : ~key;
+	double value;
+	memcpy(&value, &key, sizeof(value));
+	return value;
+}
 
-	PyObject * arg1 = NULL;
+static BATCH_CLONES void sort_keys_fill(const double* data, Py_ssize_t n, bool descending, uint64_t* keys) {
+	for (Py_ssize_t i = 0; i < n; i++) {
+		keys[i] = sort_key(data[i], descending);
+	}
+}
 
-	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist,
-		&arg1)) {
-		if (arg1 == NULL) {
-			return 0;
+static void radix_sort(uint64_t* keys, Py_ssize_t* index, Py_ssize_t n) {
+	/* Sorts <keys> stably, moving <index> (if not NULL) along with them.
+	 * Allocates scratch space of the same size, throws std::bad_alloc.
+	 */
+	std::vector<uint64_t> key_buffer((size_t)n);
+	std::vector<Py_ssize_t> index_buffer(index != NULL ? (size_t)n : 0);
+	Py_ssize_t blocks = (n + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE;
+	std::vector<Py_ssize_t> counts((size_t)(blocks * SORT_PASSES * SORT_BUCKETS));
+	auto run = [&](const std::function<void(Py_ssize_t)>& job) {
+		if (n >= SORT_PARALLEL_THRESHOLD) {
+			thread_pool_run(blocks, job);
 		}
-		if (PyExtNumber_Check(arg1)) {
-			self->value = PyExtNumber_AsDouble(arg1);
-			return 0;
+		else {
+			for (Py_ssize_t block = 0; block < blocks; block++) {
+				job(block);
+			}
+		}
+	};
+
+	// the digit counts of every pass, per block of the input order
+	run([&](Py_ssize_t block) {
+		Py_ssize_t* c = &counts[(size_t)(block * SORT_PASSES * SORT_BUCKETS)];
+		Py_ssize_t end = std::min<Py_ssize_t>(n, (block + 1) * SORT_BLOCK_SIZE);
+		for (Py_ssize_t i = block * SORT_BLOCK_SIZE; i < end; i++) {
+			uint64_t key = keys[i];
+			for (int pass = 0; pass < SORT_PASSES; pass++) {
+				c[pass * SORT_BUCKETS + (Py_ssize_t)((key >> (pass * SORT_RADIX_BITS)) & (SORT_BUCKETS - 1))]++;
+			}
+		}
+	});
+
+	uint64_t* src = keys;
+	uint64_t* dst = key_buffer.data();
+	Py_ssize_t* src_index = index;
+	Py_ssize_t* dst_index = index_buffer.data();
+	std::vector<Py_ssize_t> offsets((size_t)(blocks * SORT_BUCKETS));
+	bool recount = false; // counts only match the input order until the first pass that moves anything
+
+	for (int pass = 0; pass < SORT_PASSES; pass++) {
+		int shift = pass * SORT_RADIX_BITS;
+		bool trivial = false;
+		for (Py_ssize_t bucket = 0; bucket < SORT_BUCKETS && !trivial; bucket++) {
+			Py_ssize_t total = 0;
+			for (Py_ssize_t block = 0; block < blocks; block++) {
+				total += counts[(size_t)((block * SORT_PASSES + pass) * SORT_BUCKETS + bucket)];
+			}
+			trivial = (total == n);
+		}
+		if (trivial) {
+			continue;
+		}
+
+		if (recount) {
+			run([&](Py_ssize_t block) {
+				Py_ssize_t* c = &counts[(size_t)((block * SORT_PASSES + pass) * SORT_BUCKETS)];
+				std::fill(c, c + SORT_BUCKETS, 0);
+				Py_ssize_t end = std::min<Py_ssize_t>(n, (block + 1) * SORT_BLOCK_SIZE);
+				for (Py_ssize_t i = block * SORT_BLOCK_SIZE; i < end; i++) {
+					c[(Py_ssize_t)((src[i] >> shift) & (SORT_BUCKETS - 1))]++;
+				}
+			});
+		}
+		Py_ssize_t offset = 0;
+		for (Py_ssize_t bucket = 0; bucket < SORT_BUCKETS; bucket++) {
+			for (Py_ssize_t block = 0; block < blocks; block++) {
+				offsets[(size_t)(block * SORT_BUCKETS + bucket)] = offset;
+				offset += counts[(size_t)((block * SORT_PASSES + pass) * SORT_BUCKETS + bucket)];
+			}
+		}
+		run([&](Py_ssize_t block) {
+			Py_ssize_t* o = &offsets[(size_t)(block * SORT_BUCKETS)];
+			Py_ssize_t end = std::min<Py_ssize_t>(n, (block + 1) * SORT_BLOCK_SIZE);
+			for (Py_ssize_t i = block * SORT_BLOCK_SIZE; i < end; i++) {
+				Py_ssize_t to = o[(Py_ssize_t)((src[i] >> shift) & (SORT_BUCKETS - 1))]++;
+				dst[to] = src[i];
+				if (src_index != NULL) {
+					dst_index[to] = src_index[i];
+				}
+			}
+		});
+		std::swap(src, dst);
+		std::swap(src_index, dst_index);
+		recount = true;
+	}
+
+	if (src != keys) {
+		memcpy(keys, src, (size_t)n * sizeof(uint64_t));
+		if (index != NULL) {
+			memcpy(index, src_index, (size_t)n * sizeof(Py_ssize_t));
 		}
 	}
-	PyErr_SetString(PyExc_TypeError, "invalid argument type(s) for example_class()");
-	return -1;
 }
 
-// unaryfunc
-static PyObject *
-example_class_neg(example_class *obj)
-{
-	/* Returns the negation of <obj> on success, 
-	 * or NULL on failure. This is the 
-	 * equivalent of the Python expression '-obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
+static bool sort_keys(const double* data, Py_ssize_t n, bool descending, uint64_t* keys, Py_ssize_t* index) {
+	/* Fills <keys> with the sorted keys of <data> and <index> (if not NULL) with the positions they came from.
+	 * Large inputs are sorted with the GIL released, returns false (with MemoryError set) if scratch space is missing.
 	 */
-	return pack_example_class(-obj->value);
+	bool ok = true;
+	auto compute = [&] {
+		try {
+			sort_keys_fill(data, n, descending, keys);
+			if (index != NULL) {
+				for (Py_ssize_t i = 0; i < n; i++) {
+					index[i] = i;
+				}
+			}
+			radix_sort(keys, index, n);
+		}
+		catch (const std::bad_alloc&) {
+			ok = false;
+		}
+	};
+	if (n >= BATCH_RELEASE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		compute();
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		compute();
+	}
+	if (!ok) {
+		PyErr_NoMemory();
+	}
+	return ok;
 }
 
-static PyObject *
-example_class_pos(example_class *obj)
-{
-	/* Returns <obj> on success,
-	 * or NULL on failure. This is the
-	 * equivalent of the Python expression '+obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
+static bool sort_operand_get(template_state* state, PyObject* obj, batch_operand* op, PyObject** items) {
+	/* Like reduce_operand_get(), but lists are first copied into <items> (a new reference, NULL for other inputs),
+	 * so the results can be built from the very objects that were sorted.
+	 */
+	*items = NULL;
+	if (PyList_Check(obj)) {
+		*items = PyList_GetSlice(obj, 0, PY_SSIZE_T_MAX);
+		if (*items == NULL) {
+			return false;
+		}
+		obj = *items;
+	}
+	if (!reduce_operand_get(state, obj, op)) {
+		Py_CLEAR(*items);
+		return false;
+	}
+	return true;
+}
+
+static PyObject* sort_gather(template_state* state, batch_operand* op, PyObject* items, const Py_ssize_t* index, Py_ssize_t n) {
+	// the values at <index>, as a list of the original objects if the input was a list, otherwise as an example_class_array
+	if (items != NULL) {
+		PyObject* out = PyList_New(n);
+		for (Py_ssize_t i = 0; out != NULL && i < n; i++) {
+			PyObject* item = PyList_GET_ITEM(items, index[i]);
+			Py_INCREF(item);
+			PyList_SET_ITEM(out, i, item);
+		}
+		return out;
+	}
+	example_class_array* out = pack_example_class_array(state, NULL, n);
+	if (out != NULL) {
+		for (Py_ssize_t i = 0; i < n; i++) {
+			out->data[i] = op->data[index[i]];
+		}
+	}
+	return (PyObject*)out;
+}
+
+static bool sort_reverse_arg(PyObject* arg, bool fallback, bool* out) {
+	*out = fallback;
+	if (arg != NULL) {
+		int flag = PyObject_IsTrue(arg);
+		if (flag < 0) {
+			return false;
+		}
+		*out = flag != 0;
+	}
+	return true;
+}
+
+static PyObject* sort_result(template_state* state, batch_operand* op, PyObject* items, bool descending, bool indices) {
+	Py_ssize_t n = op->length;
+	std::vector<uint64_t> keys;
+	std::vector<Py_ssize_t> index;
+	try {
+		keys.resize((size_t)n);
+		if (indices || items != NULL) {
+			index.resize((size_t)n);
+		}
+	}
+	catch (const std::bad_alloc&) {
+		return PyErr_NoMemory();
+	}
+	if (!sort_keys(op->data, n, descending, keys.data(), index.empty() ? NULL : index.data())) {
+		return NULL;
+	}
+
+	if (indices) {
+		PyObject* out = PyList_New(n);
+		for (Py_ssize_t i = 0; out != NULL && i < n; i++) {
+			PyObject* value = PyLong_FromSsize_t(index[(size_t)i]);
+			if (value == NULL) {
+				Py_CLEAR(out);
+				break;
+			}
+			PyList_SET_ITEM(out, i, value);
+		}
+		return out;
+	}
+	if (items != NULL) {
+		return sort_gather(state, op, items, index.data(), n);
+	}
+	example_class_array* out = pack_example_class_array(state, NULL, n);
+	if (out == NULL) {
+		return NULL;
+	}
+	for (Py_ssize_t i = 0; i < n; i++) {
+		out->data[i] = sort_value(keys[(size_t)i], descending);
+	}
+	// zeros and NaNs are runs of equal keys, refilled in input order to keep their signs and payloads
+	uint64_t zero_key = sort_key(0.0, descending);
+	Py_ssize_t zero = std::lower_bound(keys.begin(), keys.end(), zero_key) - keys.begin();
+	Py_ssize_t nan = std::lower_bound(keys.begin(), keys.end(), UINT64_MAX) - keys.begin();
+	if ((zero < n && keys[(size_t)zero] == zero_key) || nan < n) {
+		for (Py_ssize_t i = 0; i < n; i++) {
+			double x = op->data[i];
+			if (x == 0.0) {
+				out->data[zero++] = x;
+			}
+			else if (x != x) {
+				out->data[nan++] = x;
+			}
+		}
+	}
+	return (PyObject*)out;
+}
+
+static PyObject* sort_apply(template_state* state, PyObject* obj, bool descending, bool indices) {
+	batch_operand o;
+	PyObject* items;
+	if (!sort_operand_get(state, obj, &o, &items)) {
+		return NULL;
+	}
+	PyObject* out = sort_result(state, &o, items, descending, indices);
+	batch_operand_release(&o);
+	Py_XDECREF(items);
+	return out;
+}
+
+struct sort_entry {
+	uint64_t key;
+	Py_ssize_t index;
+	bool operator<(const sort_entry& other) const {
+		return key < other.key || (key == other.key && index < other.index);
+	}
+};
+
+static PyObject* topk_result(template_state* state, batch_operand* op, PyObject* items, Py_ssize_t k, bool largest) {
+	/* The first k values in the order of sort(values, reverse=largest), found by a partial sort (a selection
+	 * followed by sorting only the selected entries), which beats radix sorting everything for the usual small k.
+	 */
+	Py_ssize_t n = op->length;
+	k = std::min(k, n);
+	std::vector<sort_entry> entries;
+	std::vector<Py_ssize_t> index;
+	try {
+		entries.resize((size_t)n);
+		index.resize((size_t)k);
+	}
+	catch (const std::bad_alloc&) {
+		return PyErr_NoMemory();
+	}
+	auto compute = [&] {
+		for (Py_ssize_t i = 0; i < n; i++) {
+			entries[(size_t)i].key = sort_key(op->data[i], largest);
+			entries[(size_t)i].index = i;
+		}
+		if (k < n) {
+			std::nth_element(entries.begin(), entries.begin() + k, entries.end());
+		}
+		std::sort(entries.begin(), entries.begin() + k);
+		for (Py_ssize_t i = 0; i < k; i++) {
+			index[(size_t)i] = entries[(size_t)i].index;
+		}
+	};
+	if (n >= BATCH_RELEASE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		compute();
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		compute();
+	}
+	return sort_gather(state, op, items, index.data(), k);
+}
+
+static inline Py_ssize_t search_sorted(const double* data, Py_ssize_t n, double value, bool right) {
+	// the insertion point of <value> in <data>, which must be sorted in ascending sort_key() order
+	uint64_t key = sort_key(value, false);
+	Py_ssize_t low = 0, high = n;
+	while (low < high) {
+		Py_ssize_t middle = low + (high - low) / 2;
+		uint64_t other = sort_key(data[middle], false);
+		if (right ? (other <= key) : (other < key)) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// lazy expressions
+/* template.lazy() wraps a value, an array of values or a placeholder into an example_class_expr.
+ * Arithmetic on expressions builds a tree instead of allocating intermediate results.
+ * On evaluation, the tree is compiled (once) into a postfix program which runs over blocks of EXPR_BLOCK_SIZE values,
+ * so the intermediate blocks stay in the L1 cache. Binary operations use the batch kernels,
+ * therefore the results are bit-identical to evaluating the expression eagerly with example_class objects.
+ */
+#define EXPR_BLOCK_SIZE 256
+#define EXPR_MAX_DEPTH 1000 // bounds the recursion when compiling, printing and deallocating trees
+
+static const char* expr_operator_symbols[BATCH_OP_COUNT] = { "+", "-", "*", "/", "//", "%", "**" };
+
+struct expr_instruction {
+	expr_kind kind;
+	int op; // batch_op of EXPR_BINARY
+	Py_ssize_t index; // into constants or sources
+};
+
+struct expr_program {
+	std::vector<expr_instruction> code; // postfix order
+	std::vector<double> constants;
+	std::vector<PyObject*> sources; // borrowed from the EXPR_VALUES nodes of the tree
+	Py_ssize_t stack_size;
+	bool has_argument;
+};
+
+struct expr_slot {
+	const double* data;
+	Py_ssize_t step; // 0 for a broadcast scalar
+};
+
+static example_class_expr* expr_node(template_state* state, expr_kind kind, int op, PyObject* left, PyObject* right) {
+	int depth = 1;
+	if (left != NULL && kind != EXPR_VALUES) {
+		depth = ((example_class_expr*)left)->depth + 1;
+	}
+	if (right != NULL) {
+		depth = std::max(depth, ((example_class_expr*)right)->depth + 1);
+	}
+	if (depth > EXPR_MAX_DEPTH) {
+#if PY_VERSION_HEX >= 0x03050000
+		PyErr_Format(PyExc_RecursionError, "expression is nested deeper than %d levels, evaluate parts of it first", EXPR_MAX_DEPTH);
+#else
+		PyErr_Format(PyExc_RuntimeError, "expression is nested deeper than %d levels, evaluate parts of it first", EXPR_MAX_DEPTH);
+#endif
+		return NULL;
+	}
+	example_class_expr* node = PyObject_GC_New(example_class_expr, state->example_class_expr_type);
+	if (node == NULL) {
+		return NULL;
+	}
+	node->kind = kind;
+	node->op = op;
+	node->depth = depth;
+	node->value = 0.0;
+	Py_XINCREF(left);
+	node->left = left;
+	Py_XINCREF(right);
+	node->right = right;
+	node->program = NULL;
+	PyObject_GC_Track(node);
+	return node;
+}
+
+static PyObject* expr_operand(template_state* state, PyObject* obj) {
+	/* Returns a new reference to <obj> as an expression, numbers become constants.
+	 * Returns NULL without an error set if <obj> can't be an operand.
+	 */
+	if (Py_TYPE(obj) == state->example_class_expr_type) {
+		Py_INCREF(obj);
+		return obj;
+	}
+	internal_example_class o;
+	if (!unpack_example_class(state, obj, &o)) {
+		return NULL;
+	}
+	example_class_expr* node = expr_node(state, EXPR_CONSTANT, 0, NULL, NULL);
+	if (node != NULL) {
+		node->value = o.value;
+	}
+	return (PyObject*)node;
+}
+
+static PyObject* expr_binary(template_state* state, batch_op op, PyObject* obj1, PyObject* obj2) {
+	PyObject* left = expr_operand(state, obj1);
+	if (left == NULL) {
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+	PyObject* right = expr_operand(state, obj2);
+	if (right == NULL) {
+		Py_DECREF(left);
+		Py_RETURN_NOTIMPLEMENTED_OR_ERROR;
+	}
+	PyObject* out = (PyObject*)expr_node(state, EXPR_BINARY, op, left, right);
+	Py_DECREF(left);
+	Py_DECREF(right);
+	return out;
+}
+
+static PyObject* example_class_expr_add(PyObject *obj1, PyObject *obj2) {
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_ADD, obj1, obj2);
+}
+
+static PyObject* example_class_expr_sub(PyObject *obj1, PyObject *obj2) {
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_SUB, obj1, obj2);
+}
+
+static PyObject* example_class_expr_mul(PyObject *obj1, PyObject *obj2) {
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_MUL, obj1, obj2);
+}
+
+static PyObject* example_class_expr_truediv(PyObject *obj1, PyObject *obj2) {
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_TRUEDIV, obj1, obj2);
+}
+
+static PyObject* example_class_expr_floordiv(PyObject *obj1, PyObject *obj2) {
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_FLOORDIV, obj1, obj2);
+}
+
+static PyObject* example_class_expr_mod(PyObject *obj1, PyObject *obj2) {
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_MOD, obj1, obj2);
+}
+
+static PyObject* example_class_expr_pow(PyObject * obj1, PyObject * obj2, PyObject * obj3) {
+	if (obj3 != Py_None) {
+		Py_RETURN_NOTIMPLEMENTED; // three-argument pow() isn't recorded
+	}
+	return expr_binary(template_state_of_operands(obj1, obj2), BATCH_POW, obj1, obj2);
+}
+
+static PyObject* example_class_expr_neg(PyObject *obj) {
+	return (PyObject*)expr_node(template_state_of(obj), EXPR_NEGATIVE, 0, obj, NULL);
+}
+
+static PyObject* example_class_expr_pos(PyObject *obj) {
+	return (PyObject*)expr_node(template_state_of(obj), EXPR_POSITIVE, 0, obj, NULL);
+}
+
+static PyObject* example_class_expr_abs(PyObject *obj) {
+	return (PyObject*)expr_node(template_state_of(obj), EXPR_ABSOLUTE, 0, obj, NULL);
+}
+
+static void expr_emit(example_class_expr* node, expr_program* program, Py_ssize_t* depth) {
+	// appends the postfix code of <node> to <program>, <depth> tracks the size of the evaluation stack
+	expr_instruction instruction = { node->kind, node->op, 0 };
+	switch (node->kind) {
+	case EXPR_CONSTANT:
+		instruction.index = (Py_ssize_t)program->constants.size();
+		program->constants.push_back(node->value);
+		(*depth)++;
+		break;
+	case EXPR_VALUES:
+		instruction.index = (Py_ssize_t)program->sources.size();
+		program->sources.push_back(node->left);
+		(*depth)++;
+		break;
+	case EXPR_ARGUMENT:
+		program->has_argument = true;
+		(*depth)++;
+		break;
+	case EXPR_BINARY:
+		expr_emit((example_class_expr*)node->left, program, depth);
+		expr_emit((example_class_expr*)node->right, program, depth);
+		program->stack_size = std::max(program->stack_size, *depth);
+		(*depth)--;
+		break;
+	default:
+		expr_emit((example_class_expr*)node->left, program, depth);
+		break;
+	}
+	program->stack_size = std::max(program->stack_size, *depth);
+	program->code.push_back(instruction);
+}
+
+static expr_program* expr_compile(example_class_expr* self) {
+	if (self->program == NULL) {
+		expr_program* program = new expr_program();
+		program->stack_size = 0;
+		program->has_argument = false;
+		Py_ssize_t depth = 0;
+		expr_emit(self, program, &depth);
+		self->program = program;
+	}
+	return self->program;
+}
+
+static void expr_run(const expr_program* program, const batch_operand* operands, Py_ssize_t start, Py_ssize_t n,
+	double* scratch, expr_slot* stack, double* out) {
+	/* Evaluates values [start, start + n) of <program> into <out>, n <= EXPR_BLOCK_SIZE.
+	 * Stack slot i computes into scratch[i * EXPR_BLOCK_SIZE:], a slot of scalars only computes a single value.
+	 * <operands> are the resolved sources, followed by the placeholder's values.
 	 */
-	return pack_example_class(obj->value);
+	Py_ssize_t top = 0;
+	batch_kernel const* kernels = batch_kernel_table[batch_level_current];
+	for (const expr_instruction& instruction : program->code) {
+		switch (instruction.kind) {
+		case EXPR_CONSTANT:
+			stack[top].data = &program->constants[(size_t)instruction.index];
+			stack[top++].step = 0;
+			break;
+		case EXPR_VALUES:
+		case EXPR_ARGUMENT: {
+			const batch_operand& o = operands[(instruction.kind == EXPR_VALUES) ? instruction.index : (Py_ssize_t)program->sources.size()];
+			stack[top].data = (o.length >= 0) ? o.data + start : o.data;
+			stack[top++].step = (o.length >= 0) ? 1 : 0;
+			break;
+		}
+		case EXPR_BINARY: {
+			expr_slot& a = stack[top - 2];
+			const expr_slot& b = stack[--top];
+			double* target = scratch + top * EXPR_BLOCK_SIZE - EXPR_BLOCK_SIZE;
+			Py_ssize_t step = (a.step != 0 || b.step != 0) ? 1 : 0;
+			kernels[instruction.op](a.data, a.step, b.data, b.step, target, step ? n : 1);
+			a.data = target;
+			a.step = step;
+			break;
+		}
+		default: {
+			expr_slot& a = stack[top - 1];
+			double* target = scratch + top * EXPR_BLOCK_SIZE - EXPR_BLOCK_SIZE;
+			Py_ssize_t m = a.step ? n : 1;
+			if (instruction.kind == EXPR_NEGATIVE) {
+				for (Py_ssize_t i = 0; i < m; i++) {
+					target[i] = -a.data[i];
+				}
+			}
+			else if (instruction.kind == EXPR_ABSOLUTE) {
+				for (Py_ssize_t i = 0; i < m; i++) {
+					target[i] = fabs(a.data[i]);
+				}
+			}
+			else if (a.data != target) {
+				memcpy(target, a.data, (size_t)m * sizeof(double));
+			}
+			a.data = target;
+			break;
+		}
+		}
+	}
+	if (stack[0].step == 0) {
+		std::fill(out, out + n, stack[0].data[0]);
+	}
+	else {
+		memcpy(out, stack[0].data, (size_t)n * sizeof(double));
+	}
+}
+
+static PyObject* expr_evaluate(example_class_expr* self, PyObject* argument, PyObject* out) {
+	template_state* state = template_state_of((PyObject*)self);
+	expr_program* program = expr_compile(self);
+	if (program->has_argument && argument == NULL) {
+		PyErr_SetString(PyExc_TypeError, "the expression contains a template.lazy() placeholder, use apply(values)");
+		return NULL;
+	}
+	if (!program->has_argument && argument != NULL) {
+		PyErr_SetString(PyExc_TypeError, "the expression contains no template.lazy() placeholder, use eval()");
+		return NULL;
+	}
+
+	// resolve the operands, every one is either an array or a broadcast scalar
+	size_t count = program->sources.size() + (argument != NULL);
+	std::vector<batch_operand> operands(count);
+	Py_ssize_t length = -1;
+	size_t resolved = 0;
+	for (; resolved < count; resolved++) {
+		PyObject* obj = (resolved < program->sources.size()) ? program->sources[resolved] : argument;
+		if (!batch_operand_get(state, obj, &operands[resolved])) {
+			break;
+		}
+		Py_ssize_t n = operands[resolved].length;
+		if (n >= 0 && length >= 0 && n != length) {
+			PyErr_Format(PyExc_ValueError, "operands have different lengths (%zd and %zd)", length, n);
+			resolved++;
+			break;
+		}
+		if (n >= 0) {
+			length = n;
+		}
+	}
+	if (PyErr_Occurred()) {
+		for (size_t i = 0; i < resolved; i++) {
+			batch_operand_release(&operands[i]);
+		}
+		return NULL;
+	}
+
+	bool scalar = length < 0;
+	double scalar_result;
+	Py_buffer out_view;
+	double* out_data;
+	out_view.obj = NULL;
+	if (scalar && (out == NULL || out == Py_None)) {
+		length = 1;
+		out_data = &scalar_result;
+	}
+	else if (out == NULL || out == Py_None) {
+		out = (PyObject*)pack_example_class_array(state, NULL, length);
+		out_data = (out != NULL) ? ((example_class_array*)out)->data : NULL;
+	}
+	else {
+		length = scalar ? 1 : length;
+		out_data = NULL;
+		if (PyObject_GetBuffer(out, &out_view, PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == 0) {
+			if (buffer_native_format(&out_view) != 'd' || out_view.len / out_view.itemsize != length) {
+				PyErr_Format(PyExc_ValueError, "out must be a writable buffer of %zd doubles", length);
+				PyBuffer_Release(&out_view);
+			}
+			else {
+				Py_INCREF(out);
+				out_data = (double*)out_view.buf;
+			}
+		}
+	}
+	if (out_data == NULL) {
+		for (size_t i = 0; i < count; i++) {
+			batch_operand_release(&operands[i]);
+		}
+		return NULL;
+	}
+
+	Py_ssize_t tasks = (length + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+	std::function<void(Py_ssize_t)> job = [&](Py_ssize_t task) {
+		std::vector<double> scratch((size_t)program->stack_size * EXPR_BLOCK_SIZE);
+		std::vector<expr_slot> stack((size_t)program->stack_size);
+		Py_ssize_t end = std::min(length, (task + 1) * REDUCE_BLOCK_SIZE);
+		for (Py_ssize_t start = task * REDUCE_BLOCK_SIZE; start < end; start += EXPR_BLOCK_SIZE) {
+			expr_run(program, operands.data(), start, std::min<Py_ssize_t>(EXPR_BLOCK_SIZE, end - start), scratch.data(), stack.data(), out_data + start);
+		}
+	};
+	if (length >= BATCH_RELEASE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		if (length >= REDUCE_PARALLEL_THRESHOLD) {
+			thread_pool_run(tasks, job);
+		}
+		else {
+			for (Py_ssize_t task = 0; task < tasks; task++) {
+				job(task);
+			}
+		}
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		for (Py_ssize_t task = 0; task < tasks; task++) {
+			job(task);
+		}
+	}
+
+	if (out_view.obj != NULL) {
+		PyBuffer_Release(&out_view);
+	}
+	for (size_t i = 0; i < count; i++) {
+		batch_operand_release(&operands[i]);
+	}
+	return (out_data == &scalar_result) ? pack_example_class(state, scalar_result) : out;
+}
+
+static PyObject* example_class_expr_eval(example_class_expr * self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "out", NULL };
+	PyObject* arg;
+	if (!FASTCALL_KEYWORDS_PARSE("eval", kwlist, 0, &arg)) {
+		return NULL;
+	}
+	return expr_evaluate(self, NULL, arg);
+}
+
+static PyObject* example_class_expr_apply(example_class_expr * self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "values", "out", NULL };
+	PyObject* arg[2];
+	if (!FASTCALL_KEYWORDS_PARSE("apply", kwlist, 1, arg)) {
+		return NULL;
+	}
+	return expr_evaluate(self, arg[0], arg[1]);
+}
+
+static void expr_describe(example_class_expr* node, std::string& out, bool parenthesize) {
+	switch (node->kind) {
+	case EXPR_CONSTANT: {
+		char buf[FORMAT_DOUBLE_MAX];
+		out.append(buf, (size_t)format_double(node->value, buf));
+		break;
+	}
+	case EXPR_VALUES:
+		out += '<';
+		out += Py_TYPE(node->left)->tp_name;
+		out += '>';
+		break;
+	case EXPR_ARGUMENT:
+		out += 'x';
+		break;
+	case EXPR_BINARY:
+		if (parenthesize) {
+			out += '(';
+		}
+		expr_describe((example_class_expr*)node->left, out, true);
+		out += ' ';
+		out += expr_operator_symbols[node->op];
+		out += ' ';
+		expr_describe((example_class_expr*)node->right, out, true);
+		if (parenthesize) {
+			out += ')';
+		}
+		break;
+	case EXPR_ABSOLUTE:
+		out += "abs(";
+		expr_describe((example_class_expr*)node->left, out, false);
+		out += ')';
+		break;
+	default:
+		out += (node->kind == EXPR_NEGATIVE) ? '-' : '+';
+		expr_describe((example_class_expr*)node->left, out, true);
+		break;
+	}
+}
+
+static PyObject* example_class_expr_repr(example_class_expr* self) {
+	std::string out = "lazy(";
+	expr_describe(self, out, false);
+	out += ')';
+#if PY3K
+	return PyUnicode_FromStringAndSize(out.data(), (Py_ssize_t)out.size());
+#else
+	return PyString_FromStringAndSize(out.data(), (Py_ssize_t)out.size());
+#endif
+}
+
+static int example_class_expr_traverse(example_class_expr * self, visitproc visit, void * arg) {
+	Py_VISIT_HEAPTYPE(self);
+	Py_VISIT(self->left);
+	Py_VISIT(self->right);
+	return 0;
+}
+
+static void example_class_expr_dealloc(example_class_expr* self) {
+	PyTypeObject* type = Py_TYPE(self);
+	PyObject_GC_UnTrack(self);
+	Py_XDECREF(self->left);
+	Py_XDECREF(self->right);
+	delete self->program;
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
+}
+
+// double_table
+/* The open addressing (linear probing) hash table behind example_class_set and example_class_map.
+ * Keys compare like floats (0.0 and -0.0 are the same key), except that all NaNs are treated as one key.
+ * Removing a key shifts the following entries back, so there are no tombstones.
+ */
+#define DOUBLE_TABLE_EMPTY 0x7ff0dead0000beefULL // a NaN bit pattern double_table_key() never returns
+#define DOUBLE_TABLE_MIN_SIZE 8
+
+static uint64_t double_table_key(double value) {
+	uint64_t key;
+	if (value != value) {
+		return 0x7ff8000000000000ULL;
+	}
+	if (value == 0.0) {
+		return 0;
+	}
+	memcpy(&key, &value, sizeof(key));
+	return key;
+}
+
+static double double_table_value(uint64_t key) {
+	double value;
+	memcpy(&value, &key, sizeof(value));
+	return value;
+}
+
+static size_t double_table_hash(uint64_t key) {
+	// the 64-bit finalizer of MurmurHash3, so that all bits of the key affect the slot
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+static void double_table_init(double_table* table, bool has_values) {
+	table->keys = NULL;
+	table->values = NULL;
+	table->size = 0;
+	table->used = 0;
+	table->version = 0;
+	table->has_values = has_values;
+}
+
+static bool double_table_resize(double_table* table, Py_ssize_t size) {
+	uint64_t* keys = PyMem_New(uint64_t, size);
+	PyObject** values = NULL;
+	if (keys == NULL) {
+		PyErr_NoMemory();
+		return false;
+	}
+	if (table->has_values) {
+		values = PyMem_New(PyObject*, size);
+		if (values == NULL) {
+			PyMem_Free(keys);
+			PyErr_NoMemory();
+			return false;
+		}
+	}
+	for (Py_ssize_t i = 0; i < size; i++) {
+		keys[i] = DOUBLE_TABLE_EMPTY;
+	}
+	size_t mask = (size_t)size - 1;
+	for (Py_ssize_t i = 0; i < table->size; i++) {
+		uint64_t key = table->keys[i];
+		if (key == DOUBLE_TABLE_EMPTY) {
+			continue;
+		}
+		size_t j = double_table_hash(key) & mask;
+		while (keys[j] != DOUBLE_TABLE_EMPTY) {
+			j = (j + 1) & mask;
+		}
+		keys[j] = key;
+		if (values != NULL) {
+			values[j] = table->values[i];
+		}
+	}
+	PyMem_Free(table->keys);
+	PyMem_Free(table->values);
+	table->keys = keys;
+	table->values = values;
+	table->size = size;
+	return true;
 }
 
-static PyObject *
-example_class_abs(example_class *obj)
-{
-	/* Returns the absolute value of obj, 
-	 * or NULL on failure. This is the 
-	 * equivalent of the Python expression 'abs(obj)'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	return pack_example_class(fabs(obj->value));
+static Py_ssize_t double_table_find(const double_table* table, uint64_t key) {
+	// returns the slot of <key>, or -1 if it isn't in the table
+	if (table->size == 0) {
+		return -1;
+	}
+	size_t mask = (size_t)table->size - 1;
+	for (size_t i = double_table_hash(key) & mask;; i = (i + 1) & mask) {
+		if (table->keys[i] == key) {
+			return (Py_ssize_t)i;
+		}
+		if (table->keys[i] == DOUBLE_TABLE_EMPTY) {
+			return -1;
+		}
+	}
 }
 
-// binaryfunc
-static PyObject *
-example_class_add(PyObject *obj1, PyObject *obj2)
-{
-	/* Returns the result of adding obj1 to obj2, 
-	 * or NULL on failure. This is the 
-	 * equivalent of the Python expression 'obj1 + obj2'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
+static Py_ssize_t double_table_insert(double_table* table, uint64_t key, bool* inserted) {
+	/* Returns the slot of <key>, adding it (with a NULL value) if it isn't in the table yet.
+	 * Returns -1 with an error set if the table couldn't grow.
 	 */
-	internal_example_class o1, o2;
-	
-	if (unpack_example_class(obj1, &o1) && unpack_example_class(obj2, &o2)) {
-		return pack_example_class(
-			o1.value + o2.value
-		);
+	if ((table->used + 1) * 3 > table->size * 2) {
+		if (!double_table_resize(table, (table->size > 0) ? table->size * 2 : DOUBLE_TABLE_MIN_SIZE)) {
+			return -1;
+		}
+	}
+	size_t mask = (size_t)table->size - 1;
+	for (size_t i = double_table_hash(key) & mask;; i = (i + 1) & mask) {
+		if (table->keys[i] == key) {
+			*inserted = false;
+			return (Py_ssize_t)i;
+		}
+		if (table->keys[i] == DOUBLE_TABLE_EMPTY) {
+			table->keys[i] = key;
+			if (table->values != NULL) {
+				table->values[i] = NULL;
+			}
+			table->used++;
+			table->version++;
+			*inserted = true;
+			return (Py_ssize_t)i;
+		}
 	}
-
-	Py_RETURN_NOTIMPLEMENTED;
 }
 
-static PyObject *
-example_class_sub(PyObject *obj1, PyObject *obj2)
-{
-	/* Returns the result of subtracting obj2 from obj1,
-	 * or NULL on failure. This is the
-	 * equivalent of the Python expression 'obj1 - obj2'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	internal_example_class o1, o2;
+static void double_table_remove(double_table* table, Py_ssize_t slot) {
+	// empties <slot>, the caller is responsible for the reference to its value
+	size_t mask = (size_t)table->size - 1;
+	size_t hole = (size_t)slot;
+	for (size_t j = (hole + 1) & mask; table->keys[j] != DOUBLE_TABLE_EMPTY; j = (j + 1) & mask) {
+		size_t home = double_table_hash(table->keys[j]) & mask;
+		// the entry at j may only move back if its home slot isn't cyclically within (hole, j]
+		bool reachable = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+		if (reachable) {
+			continue;
+		}
+		table->keys[hole] = table->keys[j];
+		if (table->values != NULL) {
+			table->values[hole] = table->values[j];
+		}
+		hole = j;
+	}
+	table->keys[hole] = DOUBLE_TABLE_EMPTY;
+	if (table->values != NULL) {
+		table->values[hole] = NULL;
+	}
+	table->used--;
+	table->version++;
+}
 
-	if (unpack_example_class(obj1, &o1) && unpack_example_class(obj2, &o2)) {
-		return pack_example_class(
-			o1.value - o2.value
-		);
+static void double_table_clear(double_table* table) {
+	// values are released after the table is reset, in case their deallocation touches the table
+	uint64_t* keys = table->keys;
+	PyObject** values = table->values;
+	Py_ssize_t size = table->size;
+	table->keys = NULL;
+	table->values = NULL;
+	table->size = 0;
+	table->used = 0;
+	table->version++;
+	if (values != NULL) {
+		for (Py_ssize_t i = 0; i < size; i++) {
+			if (keys[i] != DOUBLE_TABLE_EMPTY) {
+				Py_XDECREF(values[i]);
+			}
+		}
 	}
+	PyMem_Free(keys);
+	PyMem_Free(values);
+}
 
-	Py_RETURN_NOTIMPLEMENTED;
+static bool unpack_table_key(template_state* state, PyObject* key, uint64_t* out) {
+	internal_example_class o;
+	if (!unpack_example_class(state, key, &o)) {
+		if (!PyErr_Occurred()) {
+			Py_RAISE_TYPEERROR_O("must be a real number, not ", key);
+		}
+		return false;
+	}
+	*out = double_table_key(o.value);
+	return true;
 }
 
-static PyObject *
-example_class_mul(PyObject *obj1, PyObject *obj2)
-{
-	/* Returns the result of multiplying obj1 and obj2,
-	 * or NULL on failure. This is the
-	 * equivalent of the Python expression 'obj1 * obj2'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	internal_example_class o1, o2;
+static PyObject* example_class_tableIter_create(PyObject* container, double_table* table, table_iter_kind kind) {
+	TEMPLATE_COUNT(STAT_TABLE_ITER_CREATED);
+	example_class_tableIter *rgstate = PyObject_GC_New(example_class_tableIter, template_state_of(container)->example_class_tableIter_type);
+	if (!rgstate)
+		return NULL;
 
-	if (unpack_example_class(obj1, &o1) && unpack_example_class(obj2, &o2)) {
-		return pack_example_class(
-			o1.value * o2.value
-		);
-	}
+	rgstate->container = container;
+	Py_INCREF(container);
+	rgstate->table = table;
+	rgstate->pos = 0;
+	rgstate->version = table->version;
+	rgstate->kind = kind;
+	PyObject_GC_Track(rgstate);
 
-	Py_RETURN_NOTIMPLEMENTED;
+	return (PyObject *)rgstate;
 }
 
-static PyObject *
-example_class_truediv(PyObject *obj1, PyObject *obj2)
+static void
+example_class_tableIter_dealloc(example_class_tableIter *rgstate)
 {
-	/* Returns the result of dividing obj1 by obj2,
-	 * or NULL on failure. This is the
-	 * equivalent of the Python 3 expression 'obj1 / obj2',
-	 * and the Python 2 expression 'obj1.__truediv__(obj2)'.
-	 */
-	internal_example_class o1, o2;
-
-	if (unpack_example_class(obj1, &o1) && unpack_example_class(obj2, &o2)) {
-		return pack_example_class(
-			o1.value / o2.value
-		);
-	}
+	PyTypeObject* type = Py_TYPE(rgstate);
+	PyObject_GC_UnTrack(rgstate);
+	Py_XDECREF(rgstate->container);
+	type->tp_free((PyObject*)rgstate);
+	Py_DECREF_HEAPTYPE(type);
+}
 
-	Py_RETURN_NOTIMPLEMENTED;
+static int
+example_class_tableIter_traverse(example_class_tableIter *rgstate, visitproc visit, void * arg)
+{
+	Py_VISIT_HEAPTYPE(rgstate);
+	Py_VISIT(rgstate->container);
+	return 0;
 }
 
 static PyObject *
-example_class_mod(PyObject *obj1, PyObject *obj2)
+example_class_tableIter_step(example_class_tableIter *rgstate)
 {
-	/* Returns the remainder of dividing obj1 by obj2,
-	 * or NULL on failure. This is the
-	 * equivalent of the Python expression 'obj1 % obj2'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	internal_example_class o1, o2;
-
-	if (unpack_example_class(obj1, &o1) && unpack_example_class(obj2, &o2)) {
-		return pack_example_class(
-			fmod(o1.value, o2.value)
-		);
+	template_state* state = template_state_of((PyObject*)rgstate);
+	if (rgstate->container == NULL) {
+		return NULL;
 	}
-
-	Py_RETURN_NOTIMPLEMENTED;
+	double_table* table = rgstate->table;
+	if (rgstate->version != table->version) {
+		PyErr_SetString(PyExc_RuntimeError, "container changed size during iteration");
+		return NULL;
+	}
+	while (rgstate->pos < table->size) {
+		Py_ssize_t i = rgstate->pos++;
+		if (table->keys[i] == DOUBLE_TABLE_EMPTY) {
+			continue;
+		}
+		switch (rgstate->kind) {
+		case TABLE_ITER_KEYS:
+			return pack_example_class(state, double_table_value(table->keys[i]));
+		case TABLE_ITER_VALUES:
+			Py_INCREF(table->values[i]);
+			return table->values[i];
+		case TABLE_ITER_ITEMS: {
+			PyObject* key = pack_example_class(state, double_table_value(table->keys[i]));
+			if (key == NULL) {
+				return NULL;
+			}
+			PyObject* item = PyTuple_Pack(2, key, table->values[i]);
+			Py_DECREF(key);
+			return item;
+		}
+		}
+	}
+	Py_CLEAR(rgstate->container);
+	return NULL;
 }
 
 static PyObject *
-example_class_floordiv(PyObject *obj1, PyObject *obj2)
+example_class_tableIter_next(example_class_tableIter *rgstate)
 {
-	/* Returns the floor of obj1 divided by obj2,
-	 * or NULL on failure. This is the
-	 * equivalent of the Python expression 'obj1 // obj2'
-	 * and the Python 2 expression 'obj1 / obj2'.
-	 */
-	internal_example_class o1, o2;
-
-	if (unpack_example_class(obj1, &o1) && unpack_example_class(obj2, &o2)) {
-		return pack_example_class(
-			floor(o1.value / o2.value)
-		);
+	// advances with both the iterator and the container locked
+	PyObject* container;
+	Py_BEGIN_CRITICAL_SECTION(rgstate);
+	container = rgstate->container;
+	Py_XINCREF(container);
+	Py_END_CRITICAL_SECTION();
+	if (container == NULL) {
+		return NULL;
 	}
+	PyObject* item;
+	Py_BEGIN_CRITICAL_SECTION2(rgstate, container);
+	item = example_class_tableIter_step(rgstate);
+	Py_END_CRITICAL_SECTION2();
+	Py_DECREF(container);
+	return item;
+}
 
-	Py_RETURN_NOTIMPLEMENTED;
+static PyObject* double_table_box_key(template_state* state, double key, bool box) {
+	return box ? pack_example_class(state, key) : PyFloat_FromDouble(key);
 }
 
-static PyObject *
-example_class_divmod(PyObject * obj1, PyObject * obj2) {
-	/* See the built-in function divmod(). 
-	 * Returns NULL on failure. This is the 
-	 * equivalent of the Python expression 'divmod(obj1, obj2)'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
+static PyObject* double_table_to_list(template_state* state, double_table* table, table_iter_kind kind, bool box_keys) {
+	/* Lists the keys, values or items of <table>. With <box_keys>, the keys are example_class objects,
+	 * like the ones the table iterators yield, otherwise floats (used by repr).
 	 */
-	return Py_BuildValue("(OO)", example_class_floordiv(obj1, obj2), example_class_mod(obj1, obj2));
+	PyObject* out = PyList_New(0);
+	if (out == NULL) {
+		return NULL;
+	}
+	for (Py_ssize_t i = 0; i < table->size; i++) {
+		if (table->keys[i] == DOUBLE_TABLE_EMPTY) {
+			continue;
+		}
+		PyObject* item;
+		if (kind == TABLE_ITER_VALUES) {
+			item = table->values[i];
+			Py_INCREF(item);
+		}
+		else if (kind == TABLE_ITER_KEYS) {
+			item = double_table_box_key(state, double_table_value(table->keys[i]), box_keys);
+		}
+		else {
+			PyObject* key = double_table_box_key(state, double_table_value(table->keys[i]), box_keys);
+			item = (key != NULL) ? PyTuple_Pack(2, key, table->values[i]) : NULL;
+			Py_XDECREF(key);
+		}
+		if (item == NULL || PyList_Append(out, item) < 0) {
+			Py_XDECREF(item);
+			Py_DECREF(out);
+			return NULL;
+		}
+		Py_DECREF(item);
+	}
+	return out;
 }
 
-// ternaryfunc
-static PyObject *
-example_class_pow(PyObject * obj1, PyObject * obj2, PyObject * obj3) {
-	/* See the built-in function pow(). 
-	 * Returns NULL on failure. This is the 
-	 * equivalent of the Python expression 'pow(obj1, obj2, obj3)', 
-	 * where obj3 is optional.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	internal_example_class o1, o2;
+// example_class_set
 
-	if (!unpack_example_class(obj1, &o1) || !unpack_example_class(obj2, &o2)) {
-		Py_RETURN_NOTIMPLEMENTED;
+static bool example_class_set_add_values(example_class_set * self, PyObject * values) {
+	template_state* state = template_state_of((PyObject*)self);
+	batch_operand o;
+	bool inserted;
+	if (!reduce_operand_get(state, values, &o)) {
+		return false;
 	}
-
-	if (obj3 == Py_None) {
-		return pack_example_class(
-			pow(o1.value, o2.value)
-		);
+	// size the table for all the values up front, instead of growing it several times
+	Py_ssize_t size = (self->table.size > 0) ? self->table.size : DOUBLE_TABLE_MIN_SIZE;
+	while ((self->table.used + o.length) * 3 > size * 2) {
+		size *= 2;
 	}
+	if (size != self->table.size && !double_table_resize(&self->table, size)) {
+		batch_operand_release(&o);
+		return false;
+	}
+	for (Py_ssize_t i = 0; i < o.length; i++) {
+		if (double_table_insert(&self->table, double_table_key(o.data[i]), &inserted) < 0) {
+			batch_operand_release(&o);
+			return false;
+		}
+	}
+	batch_operand_release(&o);
+	return true;
+}
 
-	internal_example_class o3;
+static PyObject *
+example_class_set_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	example_class_set *self;
 
-	if (unpack_example_class(obj1, &o3)) {
-		return pack_example_class(
-			fmod(pow(o1.value, o2.value), o3.value)
-		);
+	self = (example_class_set *)type->tp_alloc(type, 0);
+	if (self != NULL) {
+		double_table_init(&self->table, false);
 	}
 
-	Py_RETURN_NOTIMPLEMENTED;
+	return (PyObject *)self;
 }
 
-// inplace
-// binaryfunc
-static PyObject *
-example_class_iadd(example_class *self, PyObject *obj)
+static int
+example_class_set_init(example_class_set *self, PyObject *args, PyObject *kwargs)
 {
-	/* Returns the result of adding obj to self, 
-	 * or NULL on failure. The operation is done in-place. 
-	 * This is the equivalent of the 
-	 * Python statement 'self += obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	example_class * temp = (example_class*)example_class_add((PyObject*)self, obj);
+	static char *kwlist[] = { (char*)"values", NULL };
 
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
+	PyObject * arg1 = NULL;
 
-	self->value = temp->value;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist,
+		&arg1)) {
+		return -1;
+	}
+	double_table_clear(&self->table);
+	if (arg1 != NULL && !example_class_set_add_values(self, arg1)) {
+		return -1;
+	}
+	return 0;
+}
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+static void
+example_class_set_dealloc(example_class_set* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+	double_table_clear(&self->table);
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
 }
 
 static PyObject *
-example_class_isub(example_class *self, PyObject *obj)
+example_class_set_repr(example_class_set* self)
 {
-	/* Returns the result of subtracting obj from self,
-	 * or NULL on failure. The operation is done in-place.
-	 * This is the equivalent of the
-	 * Python statement 'self -= obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	example_class * temp = (example_class*)example_class_sub((PyObject*)self, obj);
-
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
+	PyObject* values = double_table_to_list(template_state_of((PyObject*)self), &self->table, TABLE_ITER_KEYS, false);
+	if (values == NULL) {
+		return NULL;
+	}
+#if PY3K
+	PyObject* out = PyUnicode_FromFormat("example_class_set(%R)", values);
+#else
+	PyObject* out = PyString_FromString("example_class_set(");
+	PyString_ConcatAndDel(&out, PyObject_Repr(values));
+	PyString_ConcatAndDel(&out, PyString_FromString(")"));
+#endif
+	Py_DECREF(values);
+	return out;
+}
 
-	self->value = temp->value;
+static Py_ssize_t example_class_set_len(example_class_set * self) {
+	return self->table.used;
+}
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+static int example_class_set_contains(example_class_set * self, PyObject * value) {
+	internal_example_class o;
+	if (!unpack_example_class(template_state_of((PyObject*)self), value, &o)) {
+		return PyErr_Occurred() ? -1 : 0;
+	}
+	return double_table_find(&self->table, double_table_key(o.value)) >= 0;
 }
 
-static PyObject *
-example_class_imul(example_class *self, PyObject *obj)
-{
-	/* Returns the result of multiplying self by obj,
-	 * or NULL on failure. The operation is done in-place.
-	 * This is the equivalent of the
-	 * Python statement 'self *= obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	example_class * temp = (example_class*)example_class_mul((PyObject*)self, obj);
+static PyObject* example_class_set_add(example_class_set * self, PyObject * value) {
+	uint64_t key;
+	bool inserted;
+	if (!unpack_table_key(template_state_of((PyObject*)self), value, &key) || double_table_insert(&self->table, key, &inserted) < 0) {
+		return NULL;
+	}
+	Py_RETURN_NONE;
+}
 
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
+static PyObject* example_class_set_discard(example_class_set * self, PyObject * value) {
+	uint64_t key;
+	if (!unpack_table_key(template_state_of((PyObject*)self), value, &key)) {
+		return NULL;
+	}
+	Py_ssize_t slot = double_table_find(&self->table, key);
+	if (slot >= 0) {
+		double_table_remove(&self->table, slot);
+	}
+	Py_RETURN_NONE;
+}
 
-	self->value = temp->value;
+static PyObject* example_class_set_remove(example_class_set * self, PyObject * value) {
+	uint64_t key;
+	if (!unpack_table_key(template_state_of((PyObject*)self), value, &key)) {
+		return NULL;
+	}
+	Py_ssize_t slot = double_table_find(&self->table, key);
+	if (slot < 0) {
+		PyErr_SetObject(PyExc_KeyError, value);
+		return NULL;
+	}
+	double_table_remove(&self->table, slot);
+	Py_RETURN_NONE;
+}
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+static PyObject* example_class_set_update(example_class_set * self, PyObject * values) {
+	if (!example_class_set_add_values(self, values)) {
+		return NULL;
+	}
+	Py_RETURN_NONE;
 }
 
-static PyObject *
-example_class_itruediv(example_class *self, PyObject *obj)
-{
-	/* Returns the result of dividing self by obj,
-	 * or NULL on failure. The operation is done in-place.
-	 * This is the equivalent of the
-	 * Python 3 statement 'self /= obj'
-	 * and the Python 2 expression 'self.__itruediv__(obj).
-	 */
-	example_class * temp = (example_class*)example_class_truediv((PyObject*)self, obj);
+static PyObject* example_class_set_clear_method(example_class_set * self, PyObject * unused) {
+	double_table_clear(&self->table);
+	Py_RETURN_NONE;
+}
 
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
+static PyObject* example_class_set_to_array(example_class_set * self, PyObject * unused) {
+	example_class_array* out = pack_example_class_array(template_state_of((PyObject*)self), NULL, self->table.used);
+	if (out == NULL) {
+		return NULL;
+	}
+	Py_ssize_t j = 0;
+	for (Py_ssize_t i = 0; i < self->table.size; i++) {
+		if (self->table.keys[i] != DOUBLE_TABLE_EMPTY) {
+			out->data[j++] = double_table_value(self->table.keys[i]);
+		}
+	}
+	return (PyObject*)out;
+}
 
-	self->value = temp->value;
+static PyObject* example_class_set_reduce(example_class_set * self, PyObject * unused) {
+	PyObject* values = example_class_set_to_array(self, NULL);
+	if (values == NULL) {
+		return NULL;
+	}
+	return Py_BuildValue("(O(N))", (PyObject*)Py_TYPE(self), values);
+}
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+static PyObject* example_class_set_iter(example_class_set * self) {
+	return example_class_tableIter_create((PyObject*)self, &self->table, TABLE_ITER_KEYS);
 }
 
+// example_class_map
+
 static PyObject *
-example_class_imod(example_class *self, PyObject *obj)
+example_class_map_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
 {
-	/* Returns the remainder of self divided by obj,
-	 * or NULL on failure. The operation is done in-place.
-	 * This is the equivalent of the
-	 * Python statement 'self %= obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	example_class * temp = (example_class*)example_class_mod((PyObject*)self, obj);
+	example_class_map *self;
 
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
-
-	self->value = temp->value;
+	self = (example_class_map *)type->tp_alloc(type, 0);
+	if (self != NULL) {
+		double_table_init(&self->table, true);
+	}
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+	return (PyObject *)self;
 }
 
-static PyObject *
-example_class_ifloordiv(example_class *self, PyObject *obj)
+static int
+example_class_map_init(example_class_map *self, PyObject *args, PyObject *kwargs)
 {
-	/* Returns the floor of self divided by obj,
-	 * or NULL on failure. The operation is done in-place.
-	 * This is the equivalent of the
-	 * Python statement 'self //= obj'.
-	 * and the Python 2 statement 'self /= obj'
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	example_class * temp = (example_class*)example_class_floordiv((PyObject*)self, obj);
-
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
+	static char *kwlist[] = { (char*)"mapping", NULL };
 
-	self->value = temp->value;
+	PyObject * arg1 = NULL;
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist,
+		&arg1)) {
+		return -1;
+	}
+	double_table_clear(&self->table);
+	if (arg1 != NULL) {
+		PyObject* result = example_class_map_update(self, arg1);
+		if (result == NULL) {
+			return -1;
+		}
+		Py_DECREF(result);
+	}
+	return 0;
 }
 
-// ternaryfunc
-static PyObject *
-example_class_ipow(example_class *self, PyObject *obj1, PyObject * obj2) // obj2 is unused. It points to an invalid address!
+static int
+example_class_map_traverse(example_class_map * self, visitproc visit, void * arg)
 {
-	/* Returns the result of self to the power of obj1,
-	 * or NULL on failure. The operation is done in-place.
-	 * This is the equivalent of the
-	 * Python statement 'self **= obj'.
-	 * (quoted from https://docs.python.org/3/c-api/number.html)
-	 */
-	example_class * temp = (example_class*)example_class_pow((PyObject*)self, obj1, Py_None);
-
-	if (Py_IS_NOTIMPLEMENTED(temp)) return (PyObject*)temp;
+	Py_VISIT_HEAPTYPE(self);
+	for (Py_ssize_t i = 0; i < self->table.size; i++) {
+		if (self->table.keys[i] != DOUBLE_TABLE_EMPTY) {
+			Py_VISIT(self->table.values[i]);
+		}
+	}
+	return 0;
+}
 
-	self->value = temp->value;
+static int
+example_class_map_clear(example_class_map * self)
+{
+	double_table_clear(&self->table);
+	return 0;
+}
 
-	Py_DECREF(temp);
-	Py_INCREF(self);
-	return (PyObject*)self;
+static void
+example_class_map_dealloc(example_class_map* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+	PyObject_GC_UnTrack(self);
+	double_table_clear(&self->table);
+	type->tp_free((PyObject*)self);
+	Py_DECREF_HEAPTYPE(type);
 }
 
 static PyObject *
-example_class_str(example_class* self)
+example_class_map_repr(example_class_map* self)
 {
-	char * str_as_cstr = (char*)malloc((30) * sizeof(char));
-	snprintf(str_as_cstr, 30, "example_class( %12.6g )", self->value);
+	int status = Py_ReprEnter((PyObject*)self);
+	if (status != 0) {
+#if PY3K
+		return (status > 0) ? PyUnicode_FromString("example_class_map(...)") : NULL;
+#else
+		return (status > 0) ? PyString_FromString("example_class_map(...)") : NULL;
+#endif
+	}
+	PyObject* items = PyDict_New();
+	PyObject* out = NULL;
+	if (items != NULL) {
+		Py_ssize_t i;
+		for (i = 0; i < self->table.size; i++) {
+			if (self->table.keys[i] == DOUBLE_TABLE_EMPTY) {
+				continue;
+			}
+			PyObject* key = PyFloat_FromDouble(double_table_value(self->table.keys[i]));
+			if (key == NULL || PyDict_SetItem(items, key, self->table.values[i]) < 0) {
+				Py_XDECREF(key);
+				break;
+			}
+			Py_DECREF(key);
+		}
+		if (i == self->table.size) {
 #if PY3K
-	PyObject* out = PyUnicode_FromString(str_as_cstr);
+			out = PyUnicode_FromFormat("example_class_map(%R)", items);
 #else
-	PyObject* out = PyString_FromString(str_as_cstr);
+			out = PyString_FromString("example_class_map(");
+			PyString_ConcatAndDel(&out, PyObject_Repr(items));
+			PyString_ConcatAndDel(&out, PyString_FromString(")"));
 #endif
-	free(str_as_cstr);
+		}
+		Py_DECREF(items);
+	}
+	Py_ReprLeave((PyObject*)self);
 	return out;
 }
 
-static Py_ssize_t example_class_len(example_class * self) {
-	return (Py_ssize_t)1;
+static Py_ssize_t example_class_map_len(example_class_map * self) {
+	return self->table.used;
 }
 
-static PyObject* example_class_sq_item(example_class * self, Py_ssize_t index) {
-	switch (index) {
-	case 0:
-		return PyFloat_FromDouble(self->value);
-	default:
-		PyErr_SetString(PyExc_IndexError, "index out of range");
+static int example_class_map_contains(example_class_map * self, PyObject * key) {
+	internal_example_class o;
+	if (!unpack_example_class(template_state_of((PyObject*)self), key, &o)) {
+		return PyErr_Occurred() ? -1 : 0;
+	}
+	return double_table_find(&self->table, double_table_key(o.value)) >= 0;
+}
+
+static Py_ssize_t example_class_map_lookup(example_class_map * self, PyObject * key) {
+	// returns the slot of <key>, or -1 (with an error set if <key> couldn't be converted)
+	internal_example_class o;
+	if (!unpack_example_class(template_state_of((PyObject*)self), key, &o)) {
+		return -1;
+	}
+	return double_table_find(&self->table, double_table_key(o.value));
+}
+
+static PyObject* example_class_map_subscript(example_class_map * self, PyObject * key) {
+	Py_ssize_t slot = example_class_map_lookup(self, key);
+	if (slot < 0) {
+		if (!PyErr_Occurred()) {
+			PyErr_SetObject(PyExc_KeyError, key);
+		}
 		return NULL;
 	}
+	Py_INCREF(self->table.values[slot]);
+	return self->table.values[slot];
 }
 
-static int example_class_sq_setitem(example_class * self, Py_ssize_t index, PyObject * value) {
-	double value_as_double;
-	if (PyExtNumber_Check(value)) {
-		value_as_double = PyExtNumber_AsDouble(value);
+static int example_class_map_ass_subscript(example_class_map * self, PyObject * key, PyObject * value) {
+	if (value == NULL) {
+		Py_ssize_t slot = example_class_map_lookup(self, key);
+		if (slot < 0) {
+			if (!PyErr_Occurred()) {
+				PyErr_SetObject(PyExc_KeyError, key);
+			}
+			return -1;
+		}
+		PyObject* old = self->table.values[slot];
+		double_table_remove(&self->table, slot);
+		Py_DECREF(old);
+		return 0;
 	}
-	else {
-		Py_RAISE_TYPEERROR_O("must be a real number, not ", value);
+	uint64_t table_key;
+	bool inserted;
+	if (!unpack_table_key(template_state_of((PyObject*)self), key, &table_key)) {
 		return -1;
 	}
-	switch (index) {
-	case 0:
-		self->value = value_as_double;
-		return 0;
-	default:
-		PyErr_SetString(PyExc_IndexError, "index out of range");
+	Py_ssize_t slot = double_table_insert(&self->table, table_key, &inserted);
+	if (slot < 0) {
 		return -1;
 	}
+	PyObject* old = self->table.values[slot];
+	Py_INCREF(value);
+	self->table.values[slot] = value;
+	Py_XDECREF(old);
+	return 0;
 }
 
-static int example_class_contains(example_class * self, PyObject * value) {
-	double d;
-	if (PyExtNumber_Check(value)) {
-		d = PyExtNumber_AsDouble(value);
-		return (int)(d == self->value);
+static PyObject* example_class_map_get(example_class_map * self, FASTCALL_PARAMS) {
+	static const char* kwlist[] = { "key", "default", NULL };
+	PyObject* arg[2];
+	if (!FASTCALL_PARSE("get", kwlist, 1, arg)) {
+		return NULL;
 	}
-	return 0;
+	Py_ssize_t slot = example_class_map_lookup(self, arg[0]);
+	PyObject* out;
+	if (slot >= 0) {
+		out = self->table.values[slot];
+	}
+	else if (PyErr_Occurred()) {
+		return NULL;
+	}
+	else {
+		out = (arg[1] != NULL) ? arg[1] : Py_None;
+	}
+	Py_INCREF(out);
+	return out;
+}
+
+static PyObject* example_class_map_pop(example_class_map * self, FASTCALL_PARAMS) {
+	static const char* kwlist[] = { "key", "default", NULL };
+	PyObject* arg[2];
+	if (!FASTCALL_PARSE("pop", kwlist, 1, arg)) {
+		return NULL;
+	}
+	Py_ssize_t slot = example_class_map_lookup(self, arg[0]);
+	if (slot >= 0) {
+		PyObject* out = self->table.values[slot];
+		double_table_remove(&self->table, slot);
+		return out;
+	}
+	if (PyErr_Occurred()) {
+		return NULL;
+	}
+	if (arg[1] == NULL) {
+		PyErr_SetObject(PyExc_KeyError, arg[0]);
+		return NULL;
+	}
+	Py_INCREF(arg[1]);
+	return arg[1];
+}
 
+static PyObject* example_class_map_keys(example_class_map * self, PyObject * unused) {
+	return double_table_to_list(template_state_of((PyObject*)self), &self->table, TABLE_ITER_KEYS, true);
 }
 
-static PyObject * example_class_richcompare(example_class * self, PyObject * other, int comp_type) {
-	internal_example_class o2;
+static PyObject* example_class_map_values(example_class_map * self, PyObject * unused) {
+	return double_table_to_list(template_state_of((PyObject*)self), &self->table, TABLE_ITER_VALUES, true);
+}
 
-	if (!unpack_example_class(other, &o2)) {
-		if (comp_type == Py_EQ || comp_type == Py_NE) {
-			Py_RETURN_FALSE;
+static PyObject* example_class_map_items(example_class_map * self, PyObject * unused) {
+	return double_table_to_list(template_state_of((PyObject*)self), &self->table, TABLE_ITER_ITEMS, true);
+}
+
+static PyObject* example_class_map_update(example_class_map * self, PyObject * mapping) {
+	PyObject* items = PyMapping_Items(mapping);
+	if (items == NULL) {
+		return NULL;
+	}
+	PyObject* items_fast = PySequence_Fast(items, "items() must return a sequence");
+	Py_DECREF(items);
+	if (items_fast == NULL) {
+		return NULL;
+	}
+	for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(items_fast); i++) {
+		PyObject* item = PySequence_Fast_GET_ITEM(items_fast, i);
+		if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2) {
+			PyErr_SetString(PyExc_TypeError, "items() must return (key, value) pairs");
+			Py_DECREF(items_fast);
+			return NULL;
+		}
+		if (example_class_map_ass_subscript(self, PyTuple_GET_ITEM(item, 0), PyTuple_GET_ITEM(item, 1)) < 0) {
+			Py_DECREF(items_fast);
+			return NULL;
 		}
-		Py_RETURN_NOTIMPLEMENTED;
 	}
+	Py_DECREF(items_fast);
+	Py_RETURN_NONE;
+}
 
-	switch (comp_type) {
-	case Py_EQ :
-		if (self->value == o2.value) Py_RETURN_TRUE;
-		else Py_RETURN_FALSE;
-		break;
-	case Py_NE :
-		if (self->value != o2.value) Py_RETURN_TRUE;
-		else Py_RETURN_FALSE;
-		break;
-	case Py_LT :
-		if (self->value < o2.value) Py_RETURN_TRUE;
-		else Py_RETURN_FALSE;
-		break;
-	case Py_LE :
-		if (self->value <= o2.value) Py_RETURN_TRUE;
-		else Py_RETURN_FALSE;
-		break;
-	case Py_GT :
-		if (self->value > o2.value) Py_RETURN_TRUE;
-		else Py_RETURN_FALSE;
-		break;
-	case Py_GE :
-		if (self->value >= o2.value) Py_RETURN_TRUE;
-		else Py_RETURN_FALSE;
-		break;
-	default :
-		Py_RETURN_NOTIMPLEMENTED;
+static PyObject* example_class_map_clear_method(example_class_map * self, PyObject * unused) {
+	double_table_clear(&self->table);
+	Py_RETURN_NONE;
+}
+
+static PyObject* example_class_map_reduce(example_class_map * self, PyObject * unused) {
+	PyObject* items = PyDict_New();
+	if (items == NULL) {
+		return NULL;
+	}
+	for (Py_ssize_t i = 0; i < self->table.size; i++) {
+		if (self->table.keys[i] == DOUBLE_TABLE_EMPTY) {
+			continue;
+		}
+		PyObject* key = PyFloat_FromDouble(double_table_value(self->table.keys[i]));
+		if (key == NULL || PyDict_SetItem(items, key, self->table.values[i]) < 0) {
+			Py_XDECREF(key);
+			Py_DECREF(items);
+			return NULL;
+		}
+		Py_DECREF(key);
+	}
+	return Py_BuildValue("(O(N))", (PyObject*)Py_TYPE(self), items);
+}
+
+static PyObject* example_class_map_iter(example_class_map * self) {
+	return example_class_tableIter_create((PyObject*)self, &self->table, TABLE_ITER_KEYS);
+}
+
+static PyObject*
+testNO(PyObject* self, PyObject* obj) {
+	Py_RETURN_NONE;
+}
+
+static PyObject*
+testO(PyObject* self, PyObject* obj) {
+	Py_INCREF(obj);
+	return obj;
+}
+
+static PyObject*
+testVA(PyObject* self, FASTCALL_PARAMS) {
+	static const char* kwlist[] = { "o1", "o2", NULL };
+	PyObject* obj[2];
+	if (!FASTCALL_PARSE("testVA", kwlist, 1, obj)) {
+		return NULL;
+	}
+	if (obj[1] == NULL) {
+		Py_INCREF(obj[0]);
+		return obj[0];
+	}
+	return PyNumber_Add(obj[0], obj[1]);
+}
+
+static PyObject*
+testVK(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "o1", "o2", NULL };
+	PyObject* obj[2];
+	if (!FASTCALL_KEYWORDS_PARSE("testVK", kwlist, 1, obj)) {
+		return NULL;
+	}
+	if (obj[1] == NULL) {
+		Py_INCREF(obj[0]);
+		return obj[0];
+	}
+	return PyNumber_Add(obj[0], obj[1]);
+}
+
+static PyObject*
+freelist_stats(PyObject* self, PyObject* obj) {
+	example_class_freelist_state* freelist = &template_state_of_module(self)->freelist;
+	return Py_BuildValue("{s:n,s:n,s:K,s:K}",
+		"size", freelist->size,
+		"capacity", freelist->capacity,
+		"hits", freelist->hits,
+		"misses", freelist->misses);
+}
+
+static PyObject*
+set_freelist_size(PyObject* self, PyObject* obj) {
+	Py_ssize_t capacity = PyNumber_AsSsize_t(obj, PyExc_OverflowError);
+	if (capacity == -1 && PyErr_Occurred()) {
+		return NULL;
+	}
+	if (capacity < 0) {
+		PyErr_SetString(PyExc_ValueError, "freelist size must not be negative");
+		return NULL;
+	}
+	example_class_freelist_trim(template_state_of_module(self), capacity);
+	Py_RETURN_NONE;
+}
+
+static PyObject*
+stats(PyObject* self, PyObject* obj) {
+	PyObject* out = PyDict_New();
+#if TEMPLATE_STATS
+	unsigned long long totals[STAT_COUNT];
+	{
+		std::lock_guard<std::mutex> lock(stat_mutex);
+		stat_totals(totals);
+		for (int i = 0; i < STAT_COUNT; i++) {
+			totals[i] -= stat_baseline[i];
+		}
+	}
+	for (int i = 0; out != NULL && i < STAT_COUNT; i++) {
+		PyObject* count = PyLong_FromUnsignedLongLong(totals[i]);
+		if (count == NULL || PyDict_SetItemString(out, stat_counter_names[i], count) < 0) {
+			Py_CLEAR(out);
+		}
+		Py_XDECREF(count);
+	}
+#endif
+	return out;
+}
+
+static PyObject*
+reset_stats(PyObject* self, PyObject* obj) {
+#if TEMPLATE_STATS
+	std::lock_guard<std::mutex> lock(stat_mutex);
+	stat_totals(stat_baseline);
+#endif
+	Py_RETURN_NONE;
+}
+
+static const char* batch_kwlist[] = { "a", "b", "out", NULL };
+
+#define BATCH_FUNCTION(name, op) \
+static PyObject* \
+name(PyObject* self, FASTCALL_KEYWORDS_PARAMS) { \
+	PyObject* obj[3]; \
+	if (!FASTCALL_KEYWORDS_PARSE(#name, batch_kwlist, 2, obj)) { \
+		return NULL; \
+	} \
+	return batch_apply(template_state_of_module(self), op, obj[0], obj[1], obj[2]); \
+}
+
+BATCH_FUNCTION(add_many, BATCH_ADD)
+BATCH_FUNCTION(sub_many, BATCH_SUB)
+BATCH_FUNCTION(mul_many, BATCH_MUL)
+BATCH_FUNCTION(truediv_many, BATCH_TRUEDIV)
+BATCH_FUNCTION(floordiv_many, BATCH_FLOORDIV)
+BATCH_FUNCTION(mod_many, BATCH_MOD)
+BATCH_FUNCTION(pow_many, BATCH_POW)
+
+static PyObject*
+simd_level(PyObject* self, FASTCALL_PARAMS) {
+	static const char* kwlist[] = { "level", NULL };
+	PyObject* arg;
+	if (!FASTCALL_PARSE("simd_level", kwlist, 0, &arg)) {
+		return NULL;
+	}
+	if (arg != NULL) {
+#if PY3K
+		const char* level = PyUnicode_AsUTF8(arg);
+#else
+		const char* level = PyString_AsString(arg);
+#endif
+		if (level == NULL) {
+			return NULL;
+		}
+		int i;
+		for (i = 0; i < BATCH_LEVEL_COUNT; i++) {
+			if (strcmp(level, batch_level_names[i]) == 0) {
+				break;
+			}
+		}
+		if (i == BATCH_LEVEL_COUNT || i > batch_level_supported) {
+			PyErr_Format(PyExc_ValueError, "unsupported SIMD level '%s' (this CPU supports up to '%s')", level, batch_level_names[batch_level_supported]);
+			return NULL;
+		}
+		batch_level_current = i;
+	}
+#if PY3K
+	return PyUnicode_FromString(batch_level_names[batch_level_current]);
+#else
+	return PyString_FromString(batch_level_names[batch_level_current]);
+#endif
+}
+
+static PyObject*
+reduce_sum(PyObject* self, PyObject* obj) {
+	return reduce_apply(template_state_of_module(self), REDUCE_SUM, obj);
+}
+
+static PyObject*
+reduce_min(PyObject* self, PyObject* obj) {
+	return reduce_apply(template_state_of_module(self), REDUCE_MIN, obj);
+}
+
+static PyObject*
+reduce_max(PyObject* self, PyObject* obj) {
+	return reduce_apply(template_state_of_module(self), REDUCE_MAX, obj);
+}
+
+static PyObject*
+reduce_mean(PyObject* self, PyObject* obj) {
+	return reduce_apply(template_state_of_module(self), REDUCE_MEAN, obj);
+}
+
+static PyObject*
+reduce_dot(PyObject* self, FASTCALL_PARAMS) {
+	template_state* state = template_state_of_module(self);
+	static const char* kwlist[] = { "a", "b", NULL };
+	PyObject* obj[2];
+	batch_operand o1, o2;
+	if (!FASTCALL_PARSE("dot", kwlist, 2, obj)) {
+		return NULL;
+	}
+	if (!reduce_operand_get(state, obj[0], &o1)) {
+		return NULL;
+	}
+	if (!reduce_operand_get(state, obj[1], &o2)) {
+		batch_operand_release(&o1);
+		return NULL;
+	}
+	if (o1.length != o2.length) {
+		PyErr_Format(PyExc_ValueError, "operands have different lengths (%zd and %zd)", o1.length, o2.length);
+		batch_operand_release(&o1);
+		batch_operand_release(&o2);
+		return NULL;
 	}
-}
-
-static PyObject * example_class_getattr(PyObject * obj, PyObject * name) {
-	char * name_as_cstr = attr_name_to_cstr(name);
 
-	if (strcmp(name_as_cstr, "secret") == 0) {
-		return PyFloat_FromDouble(pi);
+	double result;
+	reduce_products items = { o1.data, o2.data };
+	if (o1.length >= BATCH_RELEASE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		result = blocked_sum(items, o1.length);
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		result = blocked_sum(items, o1.length);
 	}
 
-	return PyObject_GenericGetAttr(obj, name);
+	batch_operand_release(&o1);
+	batch_operand_release(&o2);
+	return pack_example_class(template_state_of_module(self), result);
 }
 
-// iterator
-
-static PyObject *
-example_classIter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
-{
-	example_class *sequence;
+static PyObject*
+sort(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "values", "reverse", NULL };
+	PyObject* arg[2];
+	bool reverse;
+	if (!FASTCALL_KEYWORDS_PARSE("sort", kwlist, 1, arg) || !sort_reverse_arg(arg[1], false, &reverse)) {
+		return NULL;
+	}
+	return sort_apply(template_state_of_module(self), arg[0], reverse, false);
+}
 
-	if (!PyArg_UnpackTuple(args, "__iter__", 1, 1, &sequence))
+static PyObject*
+argsort(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "values", "reverse", NULL };
+	PyObject* arg[2];
+	bool reverse;
+	if (!FASTCALL_KEYWORDS_PARSE("argsort", kwlist, 1, arg) || !sort_reverse_arg(arg[1], false, &reverse)) {
 		return NULL;
+	}
+	return sort_apply(template_state_of_module(self), arg[0], reverse, true);
+}
 
-	/* Create a new example_classIter and initialize its state - pointing to the last
-	* index in the sequence.
-	*/
-	example_classIter *rgstate = (example_classIter *)type->tp_alloc(type, 0);
-	if (!rgstate)
+static PyObject*
+topk(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "values", "k", "largest", NULL };
+	PyObject* arg[3];
+	bool largest;
+	if (!FASTCALL_KEYWORDS_PARSE("topk", kwlist, 2, arg) || !sort_reverse_arg(arg[2], true, &largest)) {
 		return NULL;
+	}
+	Py_ssize_t k = PyNumber_AsSsize_t(arg[1], PyExc_OverflowError);
+	if (k == -1 && PyErr_Occurred()) {
+		return NULL;
+	}
+	if (k < 0) {
+		PyErr_SetString(PyExc_ValueError, "k must not be negative");
+		return NULL;
+	}
+	template_state* state = template_state_of_module(self);
+	batch_operand o;
+	PyObject* items;
+	if (!sort_operand_get(state, arg[0], &o, &items)) {
+		return NULL;
+	}
+	PyObject* out = topk_result(state, &o, items, k, largest);
+	batch_operand_release(&o);
+	Py_XDECREF(items);
+	return out;
+}
 
-	rgstate->sequence = sequence;
-	Py_INCREF(sequence);
-	rgstate->seq_index = 0;
+static PyObject*
+searchsorted(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	template_state* state = template_state_of_module(self);
+	static const char* kwlist[] = { "a", "v", "side", NULL };
+	PyObject* arg[3];
+	if (!FASTCALL_KEYWORDS_PARSE("searchsorted", kwlist, 2, arg)) {
+		return NULL;
+	}
+	bool right = false;
+	if (arg[2] != NULL) {
+		right = keyword_equals(arg[2], "right");
+		if (!right && !keyword_equals(arg[2], "left")) {
+			PyErr_SetString(PyExc_ValueError, "side must be 'left' or 'right'");
+			return NULL;
+		}
+	}
+	batch_operand a, v;
+	if (!reduce_operand_get(state, arg[0], &a)) {
+		return NULL;
+	}
+	if (!batch_operand_get(state, arg[1], &v)) {
+		batch_operand_release(&a);
+		return NULL;
+	}
 
-	return (PyObject *)rgstate;
+	PyObject* out;
+	if (v.length < 0) {
+		out = PyLong_FromSsize_t(search_sorted(a.data, a.length, v.scalar, right));
+	}
+	else {
+		std::vector<Py_ssize_t> positions((size_t)v.length);
+		auto compute = [&] {
+			for (Py_ssize_t i = 0; i < v.length; i++) {
+				positions[(size_t)i] = search_sorted(a.data, a.length, v.data[i], right);
+			}
+		};
+		if (v.length >= BATCH_RELEASE_GIL_THRESHOLD) {
+			Py_BEGIN_ALLOW_THREADS
+			compute();
+			Py_END_ALLOW_THREADS
+		}
+		else {
+			compute();
+		}
+		out = PyList_New(v.length);
+		for (Py_ssize_t i = 0; out != NULL && i < v.length; i++) {
+			PyObject* position = PyLong_FromSsize_t(positions[(size_t)i]);
+			if (position == NULL) {
+				Py_CLEAR(out);
+				break;
+			}
+			PyList_SET_ITEM(out, i, position);
+		}
+	}
+	batch_operand_release(&a);
+	batch_operand_release(&v);
+	return out;
 }
 
-static void
-example_classIter_dealloc(example_classIter *rgstate)
-{
-	Py_XDECREF(rgstate->sequence);
-	Py_TYPE(rgstate)->tp_free(rgstate);
+static PyObject*
+format_many(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "values", "sep", NULL };
+	PyObject* arg[2];
+	if (!FASTCALL_KEYWORDS_PARSE("format_many", kwlist, 1, arg)) {
+		return NULL;
+	}
+	const char* sep = ", ";
+	Py_ssize_t sep_length = 2;
+	if (arg[1] != NULL) {
+#if PY3K
+		sep = PyUnicode_AsUTF8AndSize(arg[1], &sep_length);
+		if (sep == NULL) {
+			return NULL;
+		}
+#else
+		char* sep_str;
+		if (PyString_AsStringAndSize(arg[1], &sep_str, &sep_length) < 0) {
+			return NULL;
+		}
+		sep = sep_str;
+#endif
+	}
+	batch_operand o;
+	if (!reduce_operand_get(template_state_of_module(self), arg[0], &o)) {
+		return NULL;
+	}
+	PyObject* out = format_doubles("", o.data, o.length, sep, sep_length, "", o.length >= BATCH_RELEASE_GIL_THRESHOLD);
+	batch_operand_release(&o);
+	return out;
 }
 
-static PyObject *
-example_classIter_next(example_classIter *rgstate)
-{
-	if (rgstate->seq_index < 1) {
-		if (rgstate->seq_index == 0) {
-			rgstate->seq_index++;
-			return PyFloat_FromDouble(rgstate->sequence->value);
+static PyObject*
+dumps(PyObject* self, PyObject* values) {
+	batch_operand o;
+	if (!reduce_operand_get(template_state_of_module(self), values, &o)) {
+		return NULL;
+	}
+	PyObject* out = PyBytes_FromStringAndSize(NULL, SERIAL_HEADER_SIZE + o.length * (Py_ssize_t)sizeof(double));
+	if (out != NULL) {
+		char* p = PyBytes_AS_STRING(out);
+		memcpy(p, SERIAL_MAGIC, 4);
+		p[4] = SERIAL_VERSION;
+		p[5] = 'd';
+		p[6] = p[7] = 0;
+		for (int b = 0; b < 8; b++) {
+			p[8 + b] = (char)((uint64_t)o.length >> (8 * b));
 		}
+		store_doubles_le(o.data, o.length, p + SERIAL_HEADER_SIZE);
 	}
-	rgstate->seq_index = 1;
-	Py_CLEAR(rgstate->sequence);
-	return NULL;
+	batch_operand_release(&o);
+	return out;
 }
 
-static PyObject * example_class_geniter(example_class * self) {
-	example_classIter *rgstate = (example_classIter *)((&example_classIterType)->tp_alloc(&example_classIterType, 0));
-	if (!rgstate)
+static PyObject*
+loads(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	static const char* kwlist[] = { "data", "copy", NULL };
+	PyObject* arg[2];
+	if (!FASTCALL_KEYWORDS_PARSE("loads", kwlist, 1, arg)) {
+		return NULL;
+	}
+	int copy = 1;
+	if (arg[1] != NULL && (copy = PyObject_IsTrue(arg[1])) < 0) {
 		return NULL;
+	}
 
-	rgstate->sequence = self;
-	Py_INCREF(self);
-	rgstate->seq_index = 0;
+	Py_buffer view;
+	if (PyObject_GetBuffer(arg[0], &view, PyBUF_SIMPLE) < 0) {
+		return NULL;
+	}
+	const unsigned char* p = (const unsigned char*)view.buf;
+	if (view.len < SERIAL_HEADER_SIZE || memcmp(p, SERIAL_MAGIC, 4) != 0) {
+		PyBuffer_Release(&view);
+		PyErr_SetString(PyExc_ValueError, "not a template.dumps() buffer (bad magic)");
+		return NULL;
+	}
+	if (p[4] != SERIAL_VERSION || p[5] != 'd') {
+		PyBuffer_Release(&view);
+		PyErr_Format(PyExc_ValueError, "unsupported template.dumps() format (version %d, type code 0x%02x)", (int)p[4], (int)p[5]);
+		return NULL;
+	}
+	uint64_t count = 0;
+	for (int b = 0; b < 8; b++) {
+		count |= (uint64_t)p[8 + b] << (8 * b);
+	}
+	if (count != (uint64_t)(view.len - SERIAL_HEADER_SIZE) / sizeof(double) || (view.len - SERIAL_HEADER_SIZE) % sizeof(double) != 0) {
+		PyBuffer_Release(&view);
+		PyErr_Format(PyExc_ValueError, "truncated or oversized buffer: header declares %llu values, found %zd bytes of data", (unsigned long long)count, view.len - SERIAL_HEADER_SIZE);
+		return NULL;
+	}
+	Py_ssize_t length = (Py_ssize_t)count;
 
-	return (PyObject *)rgstate;
+	if (copy) {
+		example_class_array* out = pack_example_class_array(template_state_of_module(self), NULL, length);
+		if (out != NULL) {
+			load_doubles_le((const char*)p + SERIAL_HEADER_SIZE, length, out->data);
+		}
+		PyBuffer_Release(&view);
+		return (PyObject*)out;
+	}
+	PyBuffer_Release(&view);
+
+#if PY3K && PY_LITTLE_ENDIAN
+	// a memoryview of format 'd' over the values, sharing the memory of <data>
+	PyObject* out = NULL;
+	PyObject* whole = PyMemoryView_FromObject(arg[0]);
+	if (whole != NULL) {
+		PyObject* as_bytes = PyObject_CallMethod(whole, "cast", "s", "B");
+		if (as_bytes != NULL) {
+			PyObject* values = PySequence_GetSlice(as_bytes, SERIAL_HEADER_SIZE, SERIAL_HEADER_SIZE + length * (Py_ssize_t)sizeof(double));
+			if (values != NULL) {
+				out = PyObject_CallMethod(values, "cast", "s", "d");
+				Py_DECREF(values);
+			}
+			Py_DECREF(as_bytes);
+		}
+		Py_DECREF(whole);
+	}
+	return out;
+#else
+	PyErr_SetString(PyExc_ValueError, "loads(copy=False) requires Python 3 on a little-endian platform");
+	return NULL;
+#endif
 }
 
 static PyObject*
-testNO(PyObject* self, PyObject* obj) {
-	Py_RETURN_NONE;
+from_iterable(PyObject* self, PyObject* obj) {
+	return bulk_convert(template_state_of_module(self), obj, bulk_box_example_class);
 }
 
 static PyObject*
-testO(PyObject* self, PyObject* obj) {
-	return obj;
+to_floats(PyObject* self, PyObject* obj) {
+	return bulk_convert(template_state_of_module(self), obj, bulk_box_float);
 }
 
 static PyObject*
-testVA(PyObject* self, PyObject* args) {
-	PyObject* obj1;
-	PyObject* obj2 = NULL;
-	if (PyArg_ParseTuple(args, "O|O", &obj1, &obj2)) {
-		if (obj2 == NULL) {
-			return obj1;
+parse_many(PyObject* self, FASTCALL_KEYWORDS_PARAMS) {
+	template_state* state = template_state_of_module(self);
+	static const char* kwlist[] = { "data", "sep", NULL };
+	PyObject* arg[2];
+	if (!FASTCALL_KEYWORDS_PARSE("parse_many", kwlist, 1, arg)) {
+		return NULL;
+	}
+	char sep = 0;
+	if (arg[1] != NULL && arg[1] != Py_None) {
+		const char* sep_str = NULL;
+		Py_ssize_t sep_length = 0;
+#if PY3K
+		if (PyUnicode_Check(arg[1])) {
+			sep_str = PyUnicode_AsUTF8AndSize(arg[1], &sep_length);
+			if (sep_str == NULL) {
+				return NULL;
+			}
+		}
+		else if (PyBytes_Check(arg[1])) {
+			sep_str = PyBytes_AS_STRING(arg[1]);
+			sep_length = PyBytes_GET_SIZE(arg[1]);
+		}
+#else
+		if (PyString_Check(arg[1])) {
+			sep_str = PyString_AS_STRING(arg[1]);
+			sep_length = PyString_GET_SIZE(arg[1]);
+		}
+#endif
+		if (sep_str == NULL || sep_length != 1 || (unsigned char)sep_str[0] >= 0x80 || sep_str[0] == '\0') {
+			PyErr_SetString(PyExc_ValueError, "sep must be None or a single ASCII character");
+			return NULL;
+		}
+		sep = sep_str[0];
+		if (sep == '.' || sep == '+' || sep == '-' || (unsigned char)(sep - '0') <= 9) {
+			PyErr_Format(PyExc_ValueError, "'%c' cannot be used as a separator", sep);
+			return NULL;
 		}
-		return PyNumber_Add(obj1, obj2);
 	}
-	if (PyArg_UnpackTuple(args, "testVA", 1, 2, &obj1, &obj2)) {
-		if (obj2 == NULL) {
-			return obj1;
+
+	const char* buf;
+	Py_ssize_t length;
+	Py_buffer view;
+	bool has_view = false;
+#if PY3K
+	if (PyUnicode_Check(arg[0])) {
+		buf = PyUnicode_AsUTF8AndSize(arg[0], &length);
+		if (buf == NULL) {
+			return NULL;
 		}
-		return PyNumber_Add(obj1, obj2);
 	}
-	Py_RETURN_NONE;
+	else
+#endif
+	{
+		if (PyObject_TypeCheck(arg[0], state->example_class_type) || PyObject_GetBuffer(arg[0], &view, PyBUF_SIMPLE) < 0) {
+			PyErr_Clear();
+			Py_RAISE_TYPEERROR_O("parse_many() expected str or a bytes-like object, not ", arg[0]);
+			return NULL;
+		}
+		has_view = true;
+		buf = (const char*)view.buf;
+		length = view.len;
+	}
+
+	// a first pass counts the separators, so the result is allocated once
+	bool release_gil = length >= BATCH_RELEASE_GIL_THRESHOLD;
+	Py_ssize_t capacity;
+	if (release_gil) {
+		Py_BEGIN_ALLOW_THREADS
+		capacity = decimal_count_fields(buf, length, sep);
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		capacity = decimal_count_fields(buf, length, sep);
+	}
+
+	example_class_array* out = pack_example_class_array(state, NULL, capacity);
+	if (out == NULL) {
+		if (has_view) {
+			PyBuffer_Release(&view);
+		}
+		return NULL;
+	}
+	Py_ssize_t count = 0;
+	Py_ssize_t error = 0;
+	bool ok;
+	if (release_gil) {
+		Py_BEGIN_ALLOW_THREADS
+		ok = decimal_parse_fields(buf, length, sep, out->data, capacity, &count, &error);
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		ok = decimal_parse_fields(buf, length, sep, out->data, capacity, &count, &error);
+	}
+	out->length = count;
+
+	if (!ok && error < 0) {
+		PyErr_SetString(PyExc_BufferError, "parse_many() data was modified while it was parsed");
+		Py_CLEAR(out);
+	}
+	else if (!ok) {
+		Py_ssize_t token_length = decimal_find_separator(buf, error, std::min(length, error + 40), sep) - error;
+		while (token_length > 0 && decimal_is_space(buf[error + token_length - 1])) {
+			token_length--;
+		}
+		if (token_length == 0) {
+			PyErr_Format(PyExc_ValueError, "empty field (at byte %zd)", error);
+		}
+		else {
+			char token[41];
+			memcpy(token, buf + error, (size_t)token_length);
+			token[token_length] = '\0';
+			PyErr_Format(PyExc_ValueError, "could not convert '%s' to float (at byte %zd)", token, error);
+		}
+		Py_CLEAR(out);
+	}
+	if (has_view) {
+		PyBuffer_Release(&view);
+	}
+	return (PyObject*)out;
+}
+
+static PyObject*
+lazy(PyObject* self, FASTCALL_PARAMS) {
+	template_state* state = template_state_of_module(self);
+	static const char* kwlist[] = { "value", NULL };
+	PyObject* arg;
+	if (!FASTCALL_PARSE("lazy", kwlist, 0, &arg)) {
+		return NULL;
+	}
+	if (arg == NULL) {
+		return (PyObject*)expr_node(state, EXPR_ARGUMENT, 0, NULL, NULL);
+	}
+	PyObject* out = expr_operand(state, arg);
+	if (out != NULL || PyErr_Occurred()) {
+		return out;
+	}
+	// buffers of doubles are read on every evaluation, anything else is converted once
+	PyObject* values;
+	Py_buffer view;
+	char format;
+	bool doubles = false;
+	if (get_numeric_buffer(arg, &view, &format)) {
+		doubles = format == 'd';
+		PyBuffer_Release(&view);
+	}
+	if (doubles) {
+		Py_INCREF(arg);
+		values = arg;
+	}
+	else {
+		values = (PyObject*)pack_example_class_array(state, NULL, 0);
+		if (values == NULL) {
+			return NULL;
+		}
+		if (!example_class_array_extend(state, (example_class_array*)values, arg)) {
+			Py_DECREF(values);
+			return NULL;
+		}
+	}
+	out = (PyObject*)expr_node(state, EXPR_VALUES, 0, values, NULL);
+	Py_DECREF(values);
+	return out;
 }
 
 static PyObject*
-testVK(PyObject* self, PyObject* args, PyObject* kwargs) {
-	static char* kwlist[] = { "o1", "o2", NULL };
-	PyObject* obj1;
-	PyObject* obj2 = NULL;
-	if (PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &obj1, &obj2)) {
-		if (obj2 == NULL) {
-			return obj1;
+num_threads(PyObject* self, FASTCALL_PARAMS) {
+	static const char* kwlist[] = { "n", NULL };
+	PyObject* arg;
+	if (!FASTCALL_PARSE("num_threads", kwlist, 0, &arg)) {
+		return NULL;
+	}
+	unsigned size;
+	if (arg != NULL) {
+		Py_ssize_t n = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+		if (n == -1 && PyErr_Occurred()) {
+			return NULL;
+		}
+		if (n < 1 || n > 1024) {
+			PyErr_SetString(PyExc_ValueError, "the number of threads must be between 1 and 1024");
+			return NULL;
+		}
+		Py_BEGIN_ALLOW_THREADS
+		std::lock_guard<std::mutex> guard(thread_pool_mutex);
+		if ((unsigned)n != thread_pool_get_size()) {
+			thread_pool_retire();
+			thread_pool_size = (unsigned)n;
 		}
-		return PyNumber_Add(obj1, obj2);
+		size = thread_pool_size;
+		Py_END_ALLOW_THREADS
 	}
-	Py_RETURN_NONE;
+	else {
+		Py_BEGIN_ALLOW_THREADS
+		std::lock_guard<std::mutex> guard(thread_pool_mutex);
+		size = thread_pool_get_size();
+		Py_END_ALLOW_THREADS
+	}
+	return PyLong_FromUnsignedLong(size);
 }
 
 extern "C" 
@@ -990,12 +8255,70 @@ extern "C"
 		 */
 		{ "testNO", (PyCFunction)testNO, METH_NOARGS, "A test function expecting no arguments" },
 		{ "testO", (PyCFunction)testO, METH_O, "A test function expecting a single argument"},
-		{ "testVA", (PyCFunction)testVA, METH_VARARGS, "A test function expecting a list of arguments" },
-		{ "testVK", (PyCFunction)testVK, METH_VARARGS | METH_KEYWORDS, "A test function expecting a list of arguments and keywords" },
+		{ "testVA", (PyCFunction)testVA, METH_FASTCALL_COMPAT, "A test function expecting a list of arguments" },
+		{ "testVK", (PyCFunction)testVK, METH_FASTCALL_COMPAT | METH_KEYWORDS, "A test function expecting a list of arguments and keywords" },
+		{ "freelist_stats", (PyCFunction)freelist_stats, METH_NOARGS, "freelist_stats() -> dict\nReturns the size, capacity, hits and misses of the example_class freelist." },
+		{ "set_freelist_size", (PyCFunction)set_freelist_size, METH_O, "set_freelist_size(n)\nSets the maximum number of example_class objects kept for reuse." },
+		{ "stats", (PyCFunction)stats, METH_NOARGS, "stats() -> dict\nReturns how often each hot path was taken since the last reset_stats(), summed over all threads.\nThe dict is empty unless the module was compiled with TEMPLATE_STATS=1." },
+		{ "reset_stats", (PyCFunction)reset_stats, METH_NOARGS, "reset_stats()\nStarts counting from zero again." },
+		{ "add_many", (PyCFunction)add_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "add_many(a, b, out=None)\nElementwise a + b over buffers or iterables of values, scalars are broadcast." },
+		{ "sub_many", (PyCFunction)sub_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "sub_many(a, b, out=None)\nElementwise a - b over buffers or iterables of values, scalars are broadcast." },
+		{ "mul_many", (PyCFunction)mul_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "mul_many(a, b, out=None)\nElementwise a * b over buffers or iterables of values, scalars are broadcast." },
+		{ "truediv_many", (PyCFunction)truediv_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "truediv_many(a, b, out=None)\nElementwise a / b over buffers or iterables of values, scalars are broadcast." },
+		{ "floordiv_many", (PyCFunction)floordiv_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "floordiv_many(a, b, out=None)\nElementwise a // b over buffers or iterables of values, scalars are broadcast." },
+		{ "mod_many", (PyCFunction)mod_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "mod_many(a, b, out=None)\nElementwise a % b over buffers or iterables of values, scalars are broadcast." },
+		{ "pow_many", (PyCFunction)pow_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "pow_many(a, b, out=None)\nElementwise a ** b over buffers or iterables of values, scalars are broadcast." },
+		{ "simd_level", (PyCFunction)simd_level, METH_FASTCALL_COMPAT, "simd_level([level]) -> str\nReturns (or sets) the instruction set used by the batch functions: 'scalar', 'sse2', 'avx' or 'avx512'." },
+		{ "sum", (PyCFunction)reduce_sum, METH_O, "sum(values) -> example_class\nReturns the (pairwise) sum of a buffer or iterable of values." },
+		{ "min", (PyCFunction)reduce_min, METH_O, "min(values) -> example_class\nReturns the smallest of a buffer or iterable of values, or NaN if any value is NaN." },
+		{ "max", (PyCFunction)reduce_max, METH_O, "max(values) -> example_class\nReturns the largest of a buffer or iterable of values, or NaN if any value is NaN." },
+		{ "mean", (PyCFunction)reduce_mean, METH_O, "mean(values) -> example_class\nReturns the arithmetic mean of a buffer or iterable of values." },
+		{ "dot", (PyCFunction)reduce_dot, METH_FASTCALL_COMPAT, "dot(a, b) -> example_class\nReturns the dot product of two buffers or iterables of values of equal length." },
+		{ "sort", (PyCFunction)sort, METH_FASTCALL_COMPAT | METH_KEYWORDS, "sort(values, reverse=False) -> example_class_array or list\nReturns the values of a buffer or iterable in ascending (or descending) order, NaNs last. The sort is stable.\nA list is returned as a new list of the same objects, anything else as an example_class_array." },
+		{ "argsort", (PyCFunction)argsort, METH_FASTCALL_COMPAT | METH_KEYWORDS, "argsort(values, reverse=False) -> list\nReturns the indices that sort the values of a buffer or iterable, in the order of sort()." },
+		{ "topk", (PyCFunction)topk, METH_FASTCALL_COMPAT | METH_KEYWORDS, "topk(values, k, largest=True) -> example_class_array or list\nReturns the k largest (or smallest) values in order, i.e. the first k values of sort(values, reverse=largest)." },
+		{ "searchsorted", (PyCFunction)searchsorted, METH_FASTCALL_COMPAT | METH_KEYWORDS, "searchsorted(a, v, side='left') -> int or list\nReturns the index at which v (a value or a buffer / iterable of values) would be inserted into the sorted values a.\nWith side='right', equal values are skipped. NaNs sort after everything else, as in sort()." },
+		{ "format_many", (PyCFunction)format_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "format_many(values, sep=', ') -> str\nReturns sep.join(repr(float(v)) for v in values), formatted in a single pass." },
+		{ "dumps", (PyCFunction)dumps, METH_O, "dumps(values) -> bytes\nEncodes a buffer or iterable of values as a header followed by little-endian doubles." },
+		{ "loads", (PyCFunction)loads, METH_FASTCALL_COMPAT | METH_KEYWORDS, "loads(data, copy=True) -> example_class_array or memoryview\nDecodes the output of dumps(). With copy=False, returns a memoryview of format 'd' sharing the memory of data." },
+		{ "from_iterable", (PyCFunction)from_iterable, METH_O, "from_iterable(values) -> list\nConverts a list, tuple, buffer or other iterable of example_class compatible values into a list of example_class." },
+		{ "to_floats", (PyCFunction)to_floats, METH_O, "to_floats(values) -> list\nConverts a list, tuple, buffer or other iterable of example_class compatible values into a list of floats." },
+		{ "parse_many", (PyCFunction)parse_many, METH_FASTCALL_COMPAT | METH_KEYWORDS, "parse_many(data, sep=None) -> example_class_array\nParses decimal numbers from a str or bytes-like object. By default any run of whitespace and commas separates them, otherwise exactly one sep (surrounded by optional whitespace)." },
+		{ "lazy", (PyCFunction)lazy, METH_FASTCALL_COMPAT, "lazy([value]) -> example_class_expr\nWraps a number or a buffer / iterable of values into a lazily evaluated expression.\nWithout an argument, returns a placeholder that is bound by example_class_expr.apply(values)." },
+		{ "num_threads", (PyCFunction)num_threads, METH_FASTCALL_COMPAT, "num_threads([n]) -> int\nReturns (or sets) the number of threads used for large inputs." },
 		{ NULL, NULL, 0, NULL }
 	};
 
-#if PY3K
+#if TEMPLATE_HEAP_TYPES
+	static int template_exec(PyObject* m);
+	static int template_traverse(PyObject* m, visitproc visit, void* arg);
+	static int template_clear(PyObject* m);
+	static void template_free(void* m);
+
+	static PyModuleDef_Slot template_slots[] = {
+		/* PyModuleDef_Slot, the steps of multi-phase initialization (PEP 489).
+		 * reference:
+		 * https://docs.python.org/3/c-api/module.html#multi-phase-initialization
+		 */
+		{ Py_mod_exec, (void*)template_exec },
+#if PY_VERSION_HEX >= 0x030C0000
+		{ Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED },
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+		{ Py_mod_gil, Py_MOD_GIL_NOT_USED }, // see "thread safety"
+#endif
+		{ 0, NULL }
+	};
+
+	static PyModuleDef templatemodule = {
+
+		PyModuleDef_HEAD_INIT,
+		"template",
+		"A simple template for Python's C-API",
+		sizeof(template_state),
+		templatemethods, template_slots, template_traverse, template_clear, template_free
+	};
+#elif PY3K
 	static PyModuleDef templatemodule = {
 
 		PyModuleDef_HEAD_INIT,
@@ -1005,7 +8328,155 @@ extern "C"
 		templatemethods, NULL, NULL, NULL, NULL
 	};
 #endif
+}
+
+// module state lookup
+#if TEMPLATE_HEAP_TYPES
+static template_state* template_state_of_type(PyTypeObject* type) {
+	/* Returns the state of the module that created <type> or its closest base created by this module
+	 * (subclasses defined in Python have no module), or NULL if there is none.
+	 */
+	if (type->tp_methods == example_class_methods) {
+		// only types created from example_class_spec carry its method table, and their module is always ours
+		return (template_state*)PyModule_GetState(((PyHeapTypeObject*)type)->ht_module);
+	}
+	for (; type != NULL; type = type->tp_base) {
+		if (type->tp_flags & Py_TPFLAGS_HEAPTYPE) {
+			PyObject* module = ((PyHeapTypeObject*)type)->ht_module;
+			if (module != NULL && PyModule_GetDef(module) == &templatemodule) {
+				return (template_state*)PyModule_GetState(module);
+			}
+		}
+	}
+	return NULL;
+}
+
+static template_state* template_state_of_module(PyObject* module) {
+	return (template_state*)PyModule_GetState(module);
+}
+#else
+static template_state template_static_state = {
+	&example_classType, &example_classIterType, &example_class_arrayType, &example_class_setType, &example_class_mapType,
+	&example_class_tableIterType, &mapped_valuesType, &value_readerType, &example_class_exprType,
+	&variant_type<float>::type, &variant_type<int64_t>::type,
+	NULL, // pi
+	{ NULL, 0, EXAMPLE_CLASS_FREELIST_SIZE, 0, 0 },
+};
+
+static template_state* template_state_of_type(PyTypeObject* type) {
+	return &template_static_state;
+}
+
+static template_state* template_state_of_module(PyObject* module) {
+	return &template_static_state;
+}
+#endif
+
+extern "C"
+{
+	static int template_load_pi(template_state* state) {
+		PyObject* math = PyImport_ImportModule("math");
+		if (math == NULL) {
+			return -1;
+		}
+		PyObject* pi = PyObject_GetAttrString(math, "pi");
+		Py_DECREF(math);
+		if (pi == NULL) {
+			return -1;
+		}
+		state->pi = PyNumber_Float(pi);
+		Py_DECREF(pi);
+		return (state->pi != NULL) ? 0 : -1;
+	}
+
+#if TEMPLATE_HEAP_TYPES
+	static PyTypeObject* template_add_type(PyObject* module, PyType_Spec* spec, bool exported) {
+		// creates a type owned by <module>, exported types also become module attributes
+		PyTypeObject* type = (PyTypeObject*)PyType_FromModuleAndSpec(module, spec, NULL);
+		if (type != NULL && exported && PyModule_AddType(module, type) < 0) {
+			Py_CLEAR(type);
+		}
+		return type;
+	}
+
+	static int template_exec(PyObject* m) {
+		template_state* state = template_state_of_module(m);
+#ifndef Py_GIL_DISABLED
+		state->freelist.capacity = EXAMPLE_CLASS_FREELIST_SIZE;
+#endif
+
+		batch_detect_level();
+
+		if (template_load_pi(state) < 0
+			|| (state->example_class_type = template_add_type(m, &example_class_spec, true)) == NULL
+			|| (state->example_classIter_type = template_add_type(m, &example_classIter_spec, false)) == NULL
+			|| (state->example_class_array_type = template_add_type(m, &example_class_array_spec, true)) == NULL
+			|| (state->example_class_set_type = template_add_type(m, &example_class_set_spec, true)) == NULL
+			|| (state->example_class_map_type = template_add_type(m, &example_class_map_spec, true)) == NULL
+			|| (state->example_class_tableIter_type = template_add_type(m, &example_class_tableIter_spec, false)) == NULL
+			|| (state->mapped_values_type = template_add_type(m, &mapped_values_spec, true)) == NULL
+			|| (state->value_reader_type = template_add_type(m, &value_reader_spec, true)) == NULL
+			|| (state->example_class_expr_type = template_add_type(m, &example_class_expr_spec, true)) == NULL
+			|| (state->example_class_f32_type = template_add_type(m, &variant_type<float>::spec, true)) == NULL
+			|| (state->example_class_i64_type = template_add_type(m, &variant_type<int64_t>::spec, true)) == NULL)
+			return -1;
+
+		state->example_class_type->tp_vectorcall = (vectorcallfunc)example_class_vectorcall;
+#if PY_VERSION_HEX < 0x030A0000
+		// there is no Py_TPFLAGS_DISALLOW_INSTANTIATION yet
+		state->example_class_tableIter_type->tp_new = NULL;
+		state->example_class_expr_type->tp_new = NULL;
+#endif
+		return 0;
+	}
+
+	static int template_traverse(PyObject* m, visitproc visit, void* arg) {
+		template_state* state = template_state_of_module(m);
+		Py_VISIT(state->example_class_type);
+		Py_VISIT(state->example_classIter_type);
+		Py_VISIT(state->example_class_array_type);
+		Py_VISIT(state->example_class_set_type);
+		Py_VISIT(state->example_class_map_type);
+		Py_VISIT(state->example_class_tableIter_type);
+		Py_VISIT(state->mapped_values_type);
+		Py_VISIT(state->value_reader_type);
+		Py_VISIT(state->example_class_expr_type);
+		Py_VISIT(state->example_class_f32_type);
+		Py_VISIT(state->example_class_i64_type);
+		Py_VISIT(state->pi);
+		return 0;
+	}
+
+	static int template_clear(PyObject* m) {
+		template_state* state = template_state_of_module(m);
+		if (state->example_class_type != NULL) {
+			example_class_freelist_trim(state, 0);
+		}
+		Py_CLEAR(state->example_class_type);
+		Py_CLEAR(state->example_classIter_type);
+		Py_CLEAR(state->example_class_array_type);
+		Py_CLEAR(state->example_class_set_type);
+		Py_CLEAR(state->example_class_map_type);
+		Py_CLEAR(state->example_class_tableIter_type);
+		Py_CLEAR(state->mapped_values_type);
+		Py_CLEAR(state->value_reader_type);
+		Py_CLEAR(state->example_class_expr_type);
+		Py_CLEAR(state->example_class_f32_type);
+		Py_CLEAR(state->example_class_i64_type);
+		Py_CLEAR(state->pi);
+		return 0;
+	}
+
+	static void template_free(void* m) {
+		template_clear((PyObject*)m);
+	}
 
+	PyMODINIT_FUNC
+		PyInit_template(void)
+	{
+		return PyModuleDef_Init(&templatemodule);
+	}
+#else
 	PyMODINIT_FUNC
 #if PY3K
 		PyInit_template(void)
@@ -1013,14 +8484,21 @@ extern "C"
 		inittemplate(void)
 #endif
 	{
-		PyObject* mainmod = PyImport_AddModule("__main__");
-		PyObject* maindict = PyModule_GetDict(mainmod);
-
-		pi = PyFloat_AS_DOUBLE(PyObject_GetAttr(PyImport_ImportModuleEx("math", maindict, maindict, NULL), PyUnicode_FromString("pi")));
+		if (template_static_state.pi == NULL && template_load_pi(&template_static_state) < 0)
+#if PY3K
+			return NULL;
+#else
+			return;
+#endif
 
 		PyObject* m;
 
-		if (PyType_Ready(&example_classType) < 0 || PyType_Ready(&example_classIterType) < 0)
+		batch_detect_level();
+
+		if (PyType_Ready(&example_classType) < 0 || PyType_Ready(&example_classIterType) < 0 || PyType_Ready(&example_class_arrayType) < 0
+			|| PyType_Ready(&example_class_setType) < 0 || PyType_Ready(&example_class_mapType) < 0 || PyType_Ready(&example_class_tableIterType) < 0
+			|| PyType_Ready(&mapped_valuesType) < 0 || PyType_Ready(&value_readerType) < 0 || PyType_Ready(&example_class_exprType) < 0
+			|| PyType_Ready(&variant_type<float>::type) < 0 || PyType_Ready(&variant_type<int64_t>::type) < 0)
 #if PY3K
 			return NULL;
 #else
@@ -1042,8 +8520,33 @@ extern "C"
 		Py_INCREF(&example_classType);
 		PyModule_AddObject(m, "example_class", (PyObject *)&example_classType);
 
+		Py_INCREF(&example_class_arrayType);
+		PyModule_AddObject(m, "example_class_array", (PyObject *)&example_class_arrayType);
+
+		Py_INCREF(&example_class_setType);
+		PyModule_AddObject(m, "example_class_set", (PyObject *)&example_class_setType);
+
+		Py_INCREF(&example_class_mapType);
+		PyModule_AddObject(m, "example_class_map", (PyObject *)&example_class_mapType);
+
+		Py_INCREF(&mapped_valuesType);
+		PyModule_AddObject(m, "mapped_values", (PyObject *)&mapped_valuesType);
+
+		Py_INCREF(&value_readerType);
+		PyModule_AddObject(m, "value_reader", (PyObject *)&value_readerType);
+
+		Py_INCREF(&example_class_exprType);
+		PyModule_AddObject(m, "example_class_expr", (PyObject *)&example_class_exprType);
+
+		Py_INCREF(&variant_type<float>::type);
+		PyModule_AddObject(m, "example_class_f32", (PyObject *)&variant_type<float>::type);
+
+		Py_INCREF(&variant_type<int64_t>::type);
+		PyModule_AddObject(m, "example_class_i64", (PyObject *)&variant_type<int64_t>::type);
+
 #if PY3K
 		return m;
 #endif
 	}
+#endif
 }
\ No newline at end of file